@@ -0,0 +1,35 @@
+#!/bin/sh
+# Starts Xvfb and dwm on a spare display, runs bench/e2ebench against them
+# and prints its JSON report on stdout.  Arguments go to e2ebench:
+#
+#   make e2ebench && bench/e2e.sh -r 10 1 10 100 > e2e.json
+#
+# DISPLAYNUM (default :97) and SCREEN (default 1920x1080x24) override the
+# Xvfb setup.
+
+DISPLAYNUM=${DISPLAYNUM:-:97}
+SCREEN=${SCREEN:-1920x1080x24}
+cd "$(dirname "$0")/.." || exit 1
+
+for f in ./dwm ./bench/e2ebench; do
+	[ -x $f ] || { echo "e2e.sh: $f missing, run make e2ebench" >&2; exit 1; }
+done
+command -v Xvfb >/dev/null || { echo "e2e.sh: Xvfb not found" >&2; exit 1; }
+
+Xvfb $DISPLAYNUM -screen 0 $SCREEN -nolisten tcp >/dev/null 2>&1 &
+xvfb=$!
+trap 'kill $dwm $xvfb 2>/dev/null' EXIT INT TERM
+
+i=0
+until [ -e /tmp/.X11-unix/X${DISPLAYNUM#:} ]; do
+	i=$((i + 1))
+	[ $i -gt 50 ] && { echo "e2e.sh: Xvfb did not come up" >&2; exit 1; }
+	sleep 0.1
+done
+
+DISPLAY=$DISPLAYNUM ./dwm </dev/null >/dev/null 2>&1 &
+dwm=$!
+
+# e2ebench itself waits until dwm holds SubstructureRedirect and has
+# finished setup()
+DISPLAY=$DISPLAYNUM ./bench/e2ebench "$@"
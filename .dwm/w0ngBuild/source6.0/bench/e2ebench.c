@@ -0,0 +1,405 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * End-to-end latency benchmark.  Runs as an ordinary X client next to a
+ * running dwm (see e2e.sh, which sets both up under Xvfb), maps synthetic
+ * windows and drives dwm through XTest, timing what it sees come back:
+ *
+ *   map     XMapWindow() until MapNotify
+ *   focus   MODKEY+j until FocusIn on the newly focused window
+ *   tag     MODKEY+2 / MODKEY+1 until every window has been moved
+ *           off / back on screen
+ *   title   WM_NAME change of the focused window until the bar's
+ *           pixels change (polled with XGetImage)
+ *
+ * Each window count given on the command line is run for a number of
+ * rounds; percentiles in microseconds are printed as one JSON document.
+ * The key bindings are those of the shipped config.h.
+ */
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <X11/keysym.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XTest.h>
+
+#define LENGTH(X)       (sizeof X / sizeof X[0])
+#define MODKEY          XK_Super_L
+#define TIMEOUT         2e6   /* us to wait for dwm before a sample is dropped */
+
+enum { Map, Focus, Tag, Title, MetricLast };
+
+typedef struct {
+	double *v;
+	unsigned int n, size;
+	unsigned int timeouts;
+} Samples;
+
+static const char *metrics[] = { "map", "focus", "tag", "title" };
+static Display *dpy;
+static Window root, bar;
+static Window *wins;
+static Bool *mapped, *shown;
+static unsigned int nwins;
+static Window focused;
+static Samples samples[MetricLast];
+
+static void
+die(const char *msg) {
+	fprintf(stderr, "e2ebench: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static double
+now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void
+record(unsigned int metric, double t0) {
+	Samples *s = &samples[metric];
+
+	if(t0 < 0) {
+		s->timeouts++;
+		return;
+	}
+	if(s->n == s->size) {
+		s->size = s->size ? s->size * 2 : 64;
+		if(!(s->v = realloc(s->v, s->size * sizeof(double))))
+			die("out of memory");
+	}
+	s->v[s->n++] = now() - t0;
+}
+
+static int
+cmpdouble(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int
+xerrorignore(Display *d, XErrorEvent *ee) {
+	return 0;
+}
+
+static int
+winpos(Window w) {
+	unsigned int i;
+
+	for(i = 0; i < nwins; i++)
+		if(wins[i] == w)
+			return i;
+	return -1;
+}
+
+/* handles one event, keeping focused, mapped[] and shown[] current */
+static void
+handle(XEvent *ev) {
+	int i;
+
+	switch(ev->type) {
+	case FocusIn:
+		if(ev->xfocus.mode == NotifyNormal && ev->xfocus.detail != NotifyPointer
+		&& ev->xfocus.detail != NotifyInferior)
+			focused = ev->xfocus.window;
+		break;
+	case MapNotify:
+		if((i = winpos(ev->xmap.window)) >= 0)
+			mapped[i] = True;
+		break;
+	case ConfigureNotify:
+		if((i = winpos(ev->xconfigure.window)) >= 0)
+			shown[i] = ev->xconfigure.x >= 0;
+		break;
+	}
+}
+
+/* processes events until done(arg) holds; returns False on timeout */
+static Bool
+waitfor(Bool (*done)(const void *), const void *arg) {
+	double end = now() + TIMEOUT, left;
+	struct timeval tv;
+	fd_set fds;
+	XEvent ev;
+	int fd = ConnectionNumber(dpy);
+
+	while(!done(arg)) {
+		if(XPending(dpy)) {
+			XNextEvent(dpy, &ev);
+			handle(&ev);
+			continue;
+		}
+		if((left = end - now()) <= 0)
+			return False;
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		tv.tv_sec = left / 1e6;
+		tv.tv_usec = left - tv.tv_sec * 1e6;
+		select(fd + 1, &fds, NULL, NULL, &tv);
+	}
+	return True;
+}
+
+static Bool
+ismapped(const void *arg) {
+	return mapped[*(const unsigned int *)arg];
+}
+
+static Bool
+isfocused(const void *arg) {
+	return focused && focused != *(const Window *)arg;
+}
+
+static Bool
+allshown(const void *arg) {
+	unsigned int i;
+
+	for(i = 0; i < nwins; i++)
+		if(shown[i] != *(const Bool *)arg)
+			return False;
+	return True;
+}
+
+static XImage *
+grabbar(void) {
+	XWindowAttributes wa;
+
+	if(!bar || !XGetWindowAttributes(dpy, bar, &wa))
+		return NULL;
+	return XGetImage(dpy, bar, 0, 0, wa.width, wa.height, AllPlanes, ZPixmap);
+}
+
+static Bool
+barchanged(const void *arg) {
+	const XImage *old = arg;
+	XImage *img;
+	Bool changed;
+
+	if(!(img = grabbar()))
+		return False;
+	changed = memcmp(img->data, old->data, old->bytes_per_line * old->height) != 0;
+	XDestroyImage(img);
+	return changed;
+}
+
+/* dwm's bar: the topmost wide override-redirect window */
+static Window
+findbar(void) {
+	Window r, p, *kids, best = None;
+	XWindowAttributes wa;
+	unsigned int i, n;
+	int besty = 0, sw = DisplayWidth(dpy, DefaultScreen(dpy));
+
+	if(!XQueryTree(dpy, root, &r, &p, &kids, &n))
+		return None;
+	for(i = 0; i < n; i++)
+		if(XGetWindowAttributes(dpy, kids[i], &wa) && wa.override_redirect
+		&& wa.map_state == IsViewable && wa.width >= sw / 2 && wa.height <= 64
+		&& (!best || wa.y < besty)) {
+			best = kids[i];
+			besty = wa.y;
+		}
+	if(kids)
+		XFree(kids);
+	return best;
+}
+
+static void
+key(KeySym mod, KeySym sym) {
+	XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, mod), True, 0);
+	XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, sym), True, 0);
+	XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, sym), False, 0);
+	XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, mod), False, 0);
+	XFlush(dpy);
+}
+
+static Window
+spawn(unsigned int i) {
+	XSetWindowAttributes wa;
+	XClassHint ch = { "e2ebench", "E2ebench" };
+	char name[32];
+	Window w;
+
+	wa.event_mask = StructureNotifyMask|FocusChangeMask;
+	wa.background_pixel = WhitePixel(dpy, DefaultScreen(dpy));
+	w = XCreateWindow(dpy, root, 0, 0, 200, 100, 0, CopyFromParent, InputOutput,
+	                  CopyFromParent, CWEventMask|CWBackPixel, &wa);
+	snprintf(name, sizeof name, "e2e %u", i);
+	XStoreName(dpy, w, name);
+	XSetClassHint(dpy, w, &ch);
+	return w;
+}
+
+static void
+seturgent(Window w) {
+	XWMHints wmh = { 0 };
+
+	wmh.flags = XUrgencyHint;
+	XSetWMHints(dpy, w, &wmh);
+}
+
+static void
+runround(unsigned int n, unsigned int presses) {
+	unsigned int i;
+	char name[64];
+	Window prev;
+	XImage *img;
+	Bool want;
+	double t0;
+
+	nwins = n;
+	if(!(wins = calloc(n, sizeof(Window))) || !(mapped = calloc(n, sizeof(Bool)))
+	|| !(shown = calloc(n, sizeof(Bool))))
+		die("out of memory");
+	for(i = 0; i < n; i++) {
+		wins[i] = spawn(i);
+		shown[i] = True;
+		t0 = now();
+		XMapWindow(dpy, wins[i]);
+		XFlush(dpy);
+		record(Map, waitfor(ismapped, &i) ? t0 : -1);
+		if(i % 4 == 3)
+			seturgent(wins[i]);
+	}
+	if(!bar)
+		bar = findbar();
+
+	for(i = 0; n > 1 && i < presses; i++) {
+		prev = focused;
+		t0 = now();
+		key(MODKEY, XK_j);
+		record(Focus, waitfor(isfocused, &prev) ? t0 : -1);
+	}
+
+	for(i = 0; i < presses; i++) {
+		want = i & 1;
+		t0 = now();
+		key(MODKEY, want ? XK_1 : XK_2);
+		record(Tag, waitfor(allshown, &want) ? t0 : -1);
+	}
+	want = True;
+	if(!allshown(&want)) {
+		key(MODKEY, XK_1);
+		waitfor(allshown, &want);
+	}
+
+	for(i = 0; focused && i < presses; i++) {
+		XSync(dpy, False);
+		if(!(img = grabbar()))
+			break;
+		snprintf(name, sizeof name, "e2e title %u.%u", n, i);
+		t0 = now();
+		XStoreName(dpy, focused, name);
+		XFlush(dpy);
+		record(Title, waitfor(barchanged, img) ? t0 : -1);
+		XDestroyImage(img);
+	}
+
+	for(i = 0; i < n; i++)
+		XDestroyWindow(dpy, wins[i]);
+	XSync(dpy, False);
+	free(wins);
+	free(mapped);
+	free(shown);
+	wins = NULL;
+	nwins = 0;
+	focused = None;
+	usleep(100000); /* let dwm unmanage before the next round */
+}
+
+/* prints and resets the samples of one window count; returns first */
+static Bool
+report(unsigned int n, Bool first) {
+	Samples *s;
+	unsigned int m;
+	double sum;
+	unsigned int i;
+
+	for(m = 0; m < MetricLast; m++) {
+		s = &samples[m];
+		if(!s->n && !s->timeouts)
+			continue;
+		qsort(s->v, s->n, sizeof(double), cmpdouble);
+		for(sum = 0, i = 0; i < s->n; i++)
+			sum += s->v[i];
+		printf("%s\n    {\"windows\": %u, \"metric\": \"%s\", \"samples\": %u, \"timeouts\": %u",
+		       first ? "" : ",", n, metrics[m], s->n, s->timeouts);
+		first = False;
+		if(s->n)
+			printf(", \"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f, \"mean\": %.1f",
+			       s->v[0], s->v[(s->n - 1) * 50 / 100], s->v[(s->n - 1) * 90 / 100],
+			       s->v[(s->n - 1) * 99 / 100], s->v[s->n - 1], sum / s->n);
+		printf("}");
+		s->n = s->timeouts = 0;
+	}
+	return first;
+}
+
+int
+main(int argc, char *argv[]) {
+	static const unsigned int defcounts[] = { 1, 10, 50, 100 };
+	unsigned int i, r, n, rounds = 5, presses = 10;
+	Bool first = True;
+	int opt, waited, format;
+	XWindowAttributes wa;
+	Atom netsupported, type;
+	unsigned long nitems, extra;
+	unsigned char *data;
+
+	while((opt = getopt(argc, argv, "r:p:")) != -1) {
+		if(opt == 'r')
+			rounds = atoi(optarg);
+		else if(opt == 'p')
+			presses = atoi(optarg);
+		else {
+			fputs("usage: e2ebench [-r rounds] [-p presses] [count ...]\n", stderr);
+			return EXIT_FAILURE;
+		}
+	}
+	if(!(dpy = XOpenDisplay(NULL)))
+		die("cannot open display");
+	root = DefaultRootWindow(dpy);
+	if(!XTestQueryExtension(dpy, &opt, &opt, &opt, &opt))
+		die("no XTest extension");
+
+	/* wait for a window manager to hold SubstructureRedirect and to have
+	 * announced _NET_SUPPORTED, which dwm does at the end of setup().
+	 * Only looked at: selecting the redirect ourselves would make a dwm
+	 * still in checkotherwm() think another one is running. */
+	netsupported = XInternAtom(dpy, "_NET_SUPPORTED", False);
+	for(waited = 0;; waited++) {
+		if(XGetWindowAttributes(dpy, root, &wa) && wa.all_event_masks & SubstructureRedirectMask
+		&& XGetWindowProperty(dpy, root, netsupported, 0, 0, False, AnyPropertyType,
+		                      &type, &format, &nitems, &extra, &data) == Success) {
+			if(data)
+				XFree(data);
+			if(type != None)
+				break;
+		}
+		if(waited == 100)
+			die("no window manager running");
+		usleep(100000);
+	}
+	XSetErrorHandler(xerrorignore);
+	/* keep the pointer on the bar, away from enternotify() */
+	XTestFakeMotionEvent(dpy, DefaultScreen(dpy), 1, 1, 0);
+
+	printf("{\"benchmark\": \"dwm-e2e\", \"unit\": \"us\", \"rounds\": %u, \"results\": [", rounds);
+	for(i = 0; i < (optind < argc ? (unsigned int)(argc - optind) : LENGTH(defcounts)); i++) {
+		n = optind < argc ? (unsigned int)atoi(argv[optind + i]) : defcounts[i];
+		for(r = 0; r < rounds; r++)
+			runround(n, presses);
+		first = report(n, first);
+	}
+	printf("\n]}\n");
+	XCloseDisplay(dpy);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Icon scaling benchmark.  Builds icon.c on its own and feeds it a
+ * synthetic _NET_WM_ICON list like browsers publish (16 to 256 pixel
+ * images, 700 KB as 64 bit longs), then for each cell size reports the
+ * time of
+ *
+ *   pick    finding the image to scale in the list
+ *   scale   premultiplying and box filtering it down to the cell
+ *   blend   laying the result over a background
+ *
+ * both for the image iconpick() chooses and for the largest one, and the
+ * largest channel difference against a plain double precision box filter.
+ * Run with `make bench`; build with -U__SSE2__ for the scalar code.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX(A, B)               ((A) > (B) ? (A) : (B))
+#define MIN(A, B)               ((A) < (B) ? (A) : (B))
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+
+#include "../icon.c"
+
+static const int imgs[] = { 16, 24, 32, 48, 64, 128, 256 };
+static const int cells[] = { 12, 16, 20, 24, 32, 48 };
+
+static double
+now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* an opaque gradient with a soft edge, so alpha matters */
+static unsigned long *
+mkicons(unsigned long *n) {
+	unsigned long *list, *p;
+	unsigned int i, x, y, s, a;
+	double r;
+
+	for(*n = 0, i = 0; i < LENGTH(imgs); i++)
+		*n += 2 + imgs[i] * imgs[i];
+	if(!(p = list = malloc(*n * sizeof(unsigned long)))) {
+		fputs("iconbench: out of memory\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	for(i = 0; i < LENGTH(imgs); i++) {
+		s = imgs[i];
+		*p++ = s;
+		*p++ = s;
+		for(y = 0; y < s; y++)
+			for(x = 0; x < s; x++) {
+				r = hypot(x + 0.5 - s / 2.0, y + 0.5 - s / 2.0) / (s / 2.0);
+				a = r >= 1 ? 0 : r > 0.8 ? (1 - r) / 0.2 * 255 : 255;
+				*p++ = (unsigned long)a << 24 | (x * 255 / s) << 16 | (y * 255 / s) << 8 | ((x ^ y) & 0xff);
+			}
+	}
+	return list;
+}
+
+/* largest channel difference of dst against the reference box filter */
+static unsigned int
+check(const unsigned long *img, const unsigned int *dst, int sz) {
+	int w = img[0], h = img[1], dw, dh, ox, oy, x, y, dx, dy, ch, cnt;
+	unsigned int worst = 0, got, want;
+	double sum[4], a;
+	unsigned long px;
+
+	dw = MAX(1, w * sz / MAX(w, h));
+	dh = MAX(1, h * sz / MAX(w, h));
+	ox = (sz - dw) / 2;
+	oy = (sz - dh) / 2;
+	for(dy = 0; dy < dh; dy++)
+		for(dx = 0; dx < dw; dx++) {
+			memset(sum, 0, sizeof sum);
+			for(cnt = 0, y = 0; y < h; y++)
+				for(x = 0; x < w; x++) {
+					if(y * dh / h != dy || x * dw / w != dx)
+						continue;
+					px = img[2 + y * w + x];
+					a = (px >> 24 & 0xff) / 255.0;
+					for(ch = 0; ch < 3; ch++)
+						sum[ch] += (px >> 8 * ch & 0xff) * a;
+					sum[3] += px >> 24 & 0xff;
+					cnt++;
+				}
+			for(ch = 0; ch < 4; ch++) {
+				want = lround(sum[ch] / cnt);
+				got = dst[(oy + dy) * sz + ox + dx] >> 8 * ch & 0xff;
+				worst = MAX(worst, got > want ? got - want : want - got);
+			}
+		}
+	return worst;
+}
+
+int
+main(int argc, char *argv[]) {
+	static unsigned int dst[ICONCELL * ICONCELL], out[ICONCELL * ICONCELL];
+	const unsigned long *img = NULL, *big;
+	unsigned long n, *list;
+	unsigned int c, i, k, iters = 20000;
+	double t, pick, scale, blend;
+
+	if(argc != 1) {
+		fputs("usage: iconbench\n", stderr);
+		return EXIT_FAILURE;
+	}
+	list = mkicons(&n);
+	printf("%s, %lu KB of icons\n",
+#ifdef __SSE2__
+	       "sse2",
+#else
+	       "scalar",
+#endif
+	       n * sizeof(unsigned long) / 1024);
+	printf("%5s %5s %10s %10s %10s %6s\n", "cell", "image", "pick ns", "scale ns", "blend ns", "error");
+	/* what iconpick() chooses, then the largest image whatever the cell */
+	big = list + n - 2 - imgs[LENGTH(imgs) - 1] * imgs[LENGTH(imgs) - 1];
+	for(c = 0; c < LENGTH(cells); c++)
+		for(k = 0; k < 2; k++) {
+			t = now();
+			for(i = 0; i < iters; i++)
+				img = iconpick(list, n, cells[c]);
+			pick = (now() - t) / iters;
+			if(k)
+				img = big;
+			t = now();
+			for(i = 0; i < iters / 10; i++)
+				iconscale(img + 2, img[0], img[1], dst, cells[c]);
+			scale = (now() - t) / (iters / 10);
+			t = now();
+			for(i = 0; i < iters; i++)
+				iconblend(dst, cells[c] * cells[c], 0x1d1f21 + (i & 1), out);
+			blend = (now() - t) / iters;
+			printf("%5d %5lu %10.0f %10.0f %10.0f %6u\n", cells[c], img[0], pick, scale, blend,
+			       check(img, dst, cells[c]));
+		}
+	free(list);
+	return EXIT_SUCCESS;
+}
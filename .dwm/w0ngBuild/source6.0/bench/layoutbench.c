@@ -0,0 +1,178 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Headless layout benchmark.  Builds the real layout code (layout.c,
+ * bstack.c, gaplessgrid.c) against the recording X stub and arranges a
+ * synthetic monitor with 1 to 1000 tiled clients for every layout and a
+ * few nmaster/mfact/cfact combinations.  For each it reports the time of
+ * one arrange() and the configure requests it issued:
+ *
+ *   steady  nothing changed since the previous arrange
+ *   churn   mfact alternates between two values on every arrange
+ *
+ * Run with `make bench`; -h respects size hints in tiled layouts.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "../dwm.h"
+#include "xstub.h"
+
+/* what layout.c uses from dwm.c */
+static Display *dpy;
+static int sw = 1920, sh = 1080;
+static int bh = 16, th = 0;
+static Bool resizehints = False;
+static Monitor *mons;
+
+static void
+updatebarpos(Monitor *m) {
+	m->wx = m->mx;
+	m->ww = m->mw;
+	m->wy = m->my + bh;
+	m->wh = m->mh - bh;
+}
+
+static void
+restack(Monitor *m) {
+}
+
+static void
+die(const char *errstr, ...) {
+	va_list ap;
+
+	va_start(ap, errstr);
+	vfprintf(stderr, errstr, ap);
+	va_end(ap);
+	exit(EXIT_FAILURE);
+}
+
+#include "../bstack.c"
+#include "../gaplessgrid.c"
+#include "../layout.c"
+
+static const Layout layouts[] = {
+	{ "tile",        tile },
+	{ "bstack",      bstack },
+	{ "deck",        deck },
+	{ "gaplessgrid", gaplessgrid },
+	{ "monocle",     monocle },
+};
+static const unsigned int counts[] = { 1, 10, 100, 1000 };
+static const int nmasters[] = { 1, 2, 5 };
+static const double mfacts[] = { 0.55, 0.30 };
+
+static double
+now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned long
+requests(void) {
+	return xstub.configures + xstub.moves;
+}
+
+/* a monitor holding n visible tiled clients, as manage() leaves them */
+static Monitor *
+setup(const Layout *lt, unsigned int n, int nmaster, double mfact, Bool varied) {
+	static Monitor mon;
+	static double mf[2];
+	static int nm[2];
+	static const Layout *lts[2];
+	static Client *clients;
+	unsigned int i;
+	Client *c;
+
+	free(clients);
+	if(!(clients = calloc(n, sizeof(Client)))) {
+		fputs("layoutbench: out of memory\n", stderr);
+		exit(EXIT_FAILURE);
+	}
+	free(mon.vis[0]);
+	memset(&mon, 0, sizeof mon);
+	mon.mw = sw;
+	mon.mh = sh;
+	mon.tagset[0] = mon.tagset[1] = 1;
+	mon.curtag = 1;
+	mf[1] = mfact;
+	nm[1] = nmaster;
+	lts[1] = lt;
+	mon.mfacts = mf;
+	mon.nmasters = nm;
+	mon.lts = lts;
+	mon.lt[0] = mon.lt[1] = lt;
+	for(i = 0; i < n; i++) {
+		c = &clients[i];
+		c->win = i + 1;
+		c->mon = &mon;
+		c->tags = 1;
+		c->bw = c->cbw = 1;
+		c->w = c->h = 100;
+		c->cfact = varied ? 0.5 + (i % 4) * 0.5 : 1.0;
+		c->incw = 7;
+		c->inch = 13;
+		c->minw = c->basew = 20;
+		c->minh = c->baseh = 20;
+		c->hidden = True;
+		c->next = c->snext = i + 1 < n ? &clients[i + 1] : NULL;
+	}
+	mon.clients = mon.stack = n ? &clients[0] : NULL;
+	return &mon;
+}
+
+static void
+measure(Monitor *m, double mfact, Bool churn, unsigned int iters, double *ns, double *reqs) {
+	unsigned long r;
+	unsigned int i;
+	double t;
+
+	r = requests();
+	t = now();
+	for(i = 0; i < iters; i++) {
+		if(churn)
+			m->mfacts[1] = i & 1 ? mfact + 0.05 : mfact;
+		arrange(m);
+	}
+	*ns = (now() - t) / iters;
+	*reqs = (double)(requests() - r) / iters;
+}
+
+int
+main(int argc, char *argv[]) {
+	unsigned int l, n, k, f, v, iters;
+	double sns, sreq, cns, creq;
+	Monitor *m;
+
+	if(argc == 2 && !strcmp("-h", argv[1]))
+		resizehints = True;
+	else if(argc != 1) {
+		fputs("usage: layoutbench [-h]\n", stderr);
+		return EXIT_FAILURE;
+	}
+	dpy = xstubdpy;
+	printf("%-12s %5s %7s %5s %6s %12s %8s %12s %8s\n", "layout", "n", "nmaster",
+	       "mfact", "cfact", "steady ns", "req", "churn ns", "req");
+	for(l = 0; l < LENGTH(layouts); l++)
+		for(n = 0; n < LENGTH(counts); n++)
+			for(k = 0; k < LENGTH(nmasters); k++)
+				for(f = 0; f < LENGTH(mfacts); f++)
+					for(v = 0; v < 2; v++) {
+						iters = 200000 / counts[n];
+						m = setup(&layouts[l], counts[n], nmasters[k], mfacts[f], v);
+						arrange(m); /* maps everything, as the first arrange after manage() */
+						measure(m, mfacts[f], False, iters, &sns, &sreq);
+						measure(m, mfacts[f], True, iters, &cns, &creq);
+						printf("%-12s %5u %7d %5.2f %6s %12.0f %8.1f %12.0f %8.1f\n",
+						       layouts[l].symbol, counts[n], nmasters[k], mfacts[f],
+						       v ? "varied" : "equal", sns, sreq, cns, creq);
+					}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,35 @@
+/* See LICENSE file for copyright and license details. */
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "xstub.h"
+
+XStubStats xstub;
+static char fakedisplay[64];
+Display *xstubdpy = (Display *)fakedisplay;
+
+int
+XConfigureWindow(Display *dpy, Window w, unsigned int mask, XWindowChanges *wc) {
+	xstub.configures++;
+	for(; mask; mask &= mask - 1)
+		xstub.fields++;
+	return 1;
+}
+
+int
+XMoveResizeWindow(Display *dpy, Window w, int x, int y, unsigned int width, unsigned int height) {
+	xstub.moveresizes++;
+	return 1;
+}
+
+int
+XMoveWindow(Display *dpy, Window w, int x, int y) {
+	xstub.moves++;
+	return 1;
+}
+
+Status
+XSendEvent(Display *dpy, Window w, Bool propagate, long mask, XEvent *ev) {
+	xstub.events++;
+	return 1;
+}
@@ -0,0 +1,17 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Recording stand-in for the few Xlib calls the layout code makes, so it
+ * can run without a server.  Nothing is sent anywhere; the calls are only
+ * counted.
+ */
+
+typedef struct {
+	unsigned long configures;   /* XConfigureWindow */
+	unsigned long moves;        /* XMoveWindow */
+	unsigned long moveresizes;  /* XMoveResizeWindow */
+	unsigned long events;       /* XSendEvent */
+	unsigned long fields;       /* CW* bits over all XConfigureWindow calls */
+} XStubStats;
+
+extern XStubStats xstub;
+extern Display *xstubdpy;
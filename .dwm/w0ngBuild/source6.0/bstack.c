@@ -1,15 +1,15 @@
 static void
 bstack(Monitor *m) {
-	unsigned int w, h, mh, mx, tx, ty, tw, r;
+	unsigned int w, h, mh, mx, tx, ty, tw;
     float mfacts = 0, sfacts = 0;
 	unsigned int i, n;
-	Client *c;
+	Client *c, **t = m->vis[ListTiled];
 
-	for(n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
+	for(n = 0; n < m->nvis[ListTiled]; n++) {
 		if(n < m->nmasters[m->curtag])
-			mfacts += c->cfact;
+			mfacts += t[n]->cfact;
 		else
-			sfacts += c->cfact;
+			sfacts += t[n]->cfact;
 	}
 
 	if(n == 0)
@@ -24,39 +24,38 @@ bstack(Monitor *m) {
 		ty = m->wy;
 	}
 
-	for(i = mx = tx = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++, r=0) {
+	for(i = mx = tx = 0; i < n; i++) {
+		c = t[i];
         if (n == 1) {
             if (c->bw) {
                 /*[> remove border when only one window is on the current tag <]*/
                 c->oldbw = c->bw;
                 c->bw = 0;
-                r = 1;
             }
         } else if(!c->bw && c->oldbw) {
             /*[> restore border when more than one window is displayed <]*/
             c->bw = c->oldbw;
             c->oldbw = 0;
-            r = 1;
         }
 
 		if (i < m->nmasters[m->curtag]) {
 			/*w = (m->ww - mx) / (MIN(n, m->nmasters[m->curtag]) - i);*/
 			w = (m->ww - mx) * (c->cfact / mfacts);
-			resize(c,
+			place(c,
                    m->wx + mx,
                    m->wy,
                    w - (2 * c->bw),
-                   mh - (2 * c->bw),    False);
+                   mh - (2 * c->bw));
 			mx += WIDTH(c);
             mfacts -= c->cfact;
 		} else {
             h = m->wh - mh;
 			w = (m->ww - tx) * (c->cfact / sfacts);
-			resize(c,
+			place(c,
                    m->wx + tx,
                    ty,
                    w - (2 * c->bw),
-                   h - (2 * c->bw),    False);
+                   h - (2 * c->bw));
 			if(tw != m->ww) // TODO: what's this for? doesn't seem to be necessary; it simply checks if found stack width != window width, meaning there are more than 1 slaves;
 				tx += WIDTH(c);
             sfacts -= c->cfact;
@@ -48,11 +48,13 @@ static const char colors[NUMCOLORS][ColLast][9] = {
 
 static const unsigned int borderpx  = 2;        /* border pixel of windows */
 static const unsigned int snap      = 25;       /* snap pixel */
+static const unsigned int refreshrate = 60;    /* interactive resizes per second */
 static const Bool showbar           = True;     /* False means no bar */
 static const Bool topbar            = True;     /* False means bottom bar */
 static const unsigned int systrayspacing = 2;   /* systray spacing */
 static const Bool showsystray       = True;     /* False means no systray */
-static const Bool transfer_pointer  = True;     /* False means do not move pointer to another mon on monitor change (focusmon() & altTab()) */
+static const Bool transfer_pointer  = True;     /* False means do not move pointer to another mon on monitor change (focusmon()) */
+static const char *synergyservers[] = { "synergys", "barriers" }; /* focusmon_() hands over to their clients */
 
 
 // these two cannot be both set to true!: (at least until focus() gets another param
@@ -60,7 +62,7 @@ static const Bool transfer_pointer  = True;     /* False means do not move point
 static /*!const*/ Bool focus_follows_mouse     = True;         /* toggle focus-follows-mouse default */
 static /*!const*/ Bool mouse_follows_focus     = False;        /* again, default, since it's toggleable */
 
-static const unsigned int cellWidth = 300;      /* altTab's window width;  TODO: deleteme? */
+static const unsigned int cellWidth = 300;      /* altTab's switcher width */
 static const unsigned int tabWidth  = 200;      /* default tab width;
                                                    (if more tabs are added, width is
                                                    decreased so all tabs fit onto the bar) */
@@ -14,14 +14,29 @@ X11LIB = /usr/X11R6/lib
 XINERAMALIBS = -L${X11LIB} -lXinerama
 XINERAMAFLAGS = -DXINERAMA
 
+# XCB, pipelines the property requests in manage() and scan(); comment out
+# to fall back to plain Xlib
+XCBLIBS = -lX11-xcb -lxcb
+XCBFLAGS = -DXCB
+
+# XSync, lets interactive resizes wait for clients speaking
+# _NET_WM_SYNC_REQUEST; comment out to pace by refreshrate alone
+SYNCLIBS = -lXext
+SYNCFLAGS = -DXSYNC
+
+# XRandR 1.5 monitors, incremental hotplug with parked monitors; comment out
+# to use Xinerama alone
+XRANDRLIBS = -lXrandr
+XRANDRFLAGS = -DXRANDR
+
 # includes and libs
 # if during installation gives "/usr/bin/ld: cannot find -lXtst", then
 # apt-get install libxtst-dev
 INCS = -I. -I/usr/include -I${X11INC}
-LIBS = -L/usr/lib -lc -L${X11LIB} -lX11 ${XINERAMALIBS} -lXtst -lX11 -lm
+LIBS = -L/usr/lib -lc -L${X11LIB} -lX11 ${XINERAMALIBS} ${XCBLIBS} ${SYNCLIBS} ${XRANDRLIBS} -lXtst -lX11 -lm
 
 # flags
-CPPFLAGS = -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS}
+CPPFLAGS = -D_DEFAULT_SOURCE -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS} ${XCBFLAGS} ${SYNCFLAGS} ${XRANDRFLAGS}
 #CFLAGS = -g -std=c99 -pedantic -Wall -O0 ${INCS} ${CPPFLAGS}
 CFLAGS = -std=c99 -pedantic -Wall -Os ${INCS} ${CPPFLAGS}
 #LDFLAGS = -g ${LIBS}
@@ -20,14 +20,20 @@
  *
  * To understand everything else, start reading main().
  */
+#include <dirent.h>
 #include <errno.h>
+#include <limits.h>
 #include <locale.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <wchar.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <X11/cursorfont.h>
@@ -39,29 +45,45 @@
 #include <X11/extensions/XTest.h>
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
-#include <limits.h>
 /*#include <X11/Intrinsic.h>*/
 #endif /* XINERAMA */
+#ifdef XCB
+#include <X11/Xlib-xcb.h>
+#endif /* XCB */
+#ifdef XSYNC
+#include <X11/extensions/sync.h>
+#endif /* XSYNC */
+#ifdef XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif /* XRANDR */
+
+#include "dwm.h"
 
 /* macros */
 #define BUTTONMASK              (ButtonPressMask|ButtonReleaseMask)
 #define CLEANMASK(mask)         (mask & ~(numlockmask|LockMask) & (ShiftMask|ControlMask|Mod1Mask|Mod2Mask|Mod3Mask|Mod4Mask|Mod5Mask))
 #define INTERSECT(x,y,w,h,m)    (MAX(0, MIN((x)+(w),(m)->wx+(m)->ww) - MAX((x),(m)->wx)) \
 			       * MAX(0, MIN((y)+(h),(m)->wy+(m)->wh) - MAX((y),(m)->wy)))
-#define ISVISIBLE(C)            ((C->tags & C->mon->tagset[C->mon->seltags]))
-#define LENGTH(X)               (sizeof X / sizeof X[0])
-#define MAX(A, B)               ((A) > (B) ? (A) : (B))
-#define MIN(A, B)               ((A) < (B) ? (A) : (B))
 #define MAXCOLORS 18            // avoid circular reference to NUMCOLORS
 #define occupiedColorIndex 12   // as in tag/tab is occupied, but NOT selected
 #define MOUSEMASK               (BUTTONMASK|PointerMotionMask)
-#define WIDTH(X)                ((X)->w + 2 * (X)->bw)
-#define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
 #define TAGMASK                 ((1 << LENGTH(tags)) - 1)
 #define TEXTW(X)                (textnw(X, strlen(X)) + dc.font.height)
 #define SYSTEM_TRAY_REQUEST_DOCK    0
 #define _NET_SYSTEM_TRAY_ORIENTATION_HORZ 0
-#define MAXTABS 50
+#define DirtyBar                (DirtyTags|DirtyLtSymbol|DirtyTitle|DirtyStatus)
+#define DirtyAll                (DirtyBar|DirtyTabs|DirtySystray)
+#define EVBATCH                 256  /* max events drained per run() iteration */
+#define GLYPHCACHE              512  /* glyph advances cached per font */
+#define LONGBITS                (sizeof(unsigned long) * CHAR_BIT)
+#define RULEWORDS               ((LENGTH(rules) + LONGBITS - 1) / LONGBITS)  /* rule bitset size */
+/* _DWM_STATE layout, in longs; see savestate() */
+#define STATEMAGIC              0x64776d31L  /* "dwm1" */
+#define STATEHDR                8
+#define STATEMON(T)             (12 + 3 * (T))
+#define STATECLIENT             15
+#define STATEFIXED              1000000.0    /* scale of factors stored as longs */
+#define SYNCWAIT                100          /* ms a paced resize waits for the client to draw */
 
 /* XEMBED messages */
 #define XEMBED_EMBEDDED_NOTIFY      0
@@ -80,20 +102,24 @@
 #define XEMBED_EMBEDDED_VERSION (VERSION_MAJOR << 16) | VERSION_MINOR
 
 /* enums */
+enum { DirtyTags = 1<<0, DirtyLtSymbol = 1<<1, DirtyTitle = 1<<2,
+       DirtyStatus = 1<<3, DirtyTabs = 1<<4, DirtySystray = 1<<5 }; /* bar regions */
 /*enum { CurNormal, CurResize, CurMove, CurLast };        [> cursor <]*/
 enum { CurNormal, CurMove, CurRzUpCorLeft, CurRzUpCorRight, CurRzDnCorLeft,
       CurRzDnCorRight, CurRzMidUp, CurRzMidRight, CurRzMidDn, CurRzMidLeft, CurLast };        /* cursors */
 enum { ColBorder, ColFG, ColBG, ColLast };              /* color */
 enum { ColNorm, ColSel, ColUrg };              /* color */
 enum { NetSupported, NetWMDemandsAttention, NetSystemTray, NetSystemTrayOP, NetSystemTrayOrientation,
-      NetWMName, NetWMState, NetWMFullscreen, NetActiveWindow, NetWMWindowType,
+      NetWMName, NetWMIcon, NetWMState, NetWMFullscreen, NetActiveWindow, NetWMWindowType,
       NetWMWindowTypeDialog, NetLast }; /* EWMH atoms */
 enum { Manager, Xembed, XembedInfo, XLast }; /* Xembed atoms */
-enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
+enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMDwmState,
+       WMSyncRequest, WMSyncCounter, WMLast }; /* default atoms */
 enum { ClkTagBar, ClkTabBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast };             /* clicks */
 enum { UpCorLeft, UpCenter, UpCorRight, MidSideLeft, MidCenter,
        MidSideRight, DnCorLeft, DnCenter, DnCorRight };             /* window sectors */
+enum { RuleClass, RuleInstance, RuleTitle, RuleLast }; /* matched rule fields */
 
 typedef union {
 	int i;
@@ -110,39 +136,23 @@ typedef struct {
 	const Arg arg;
 } Button;
 
-typedef struct Monitor Monitor;
-typedef struct Client Client;
-struct Client {
-	char name[256];
-    char className[256];
-	float mina, maxa;
-	float cfact;
-	int x, y, w, h;
-	int sfx, sfy, sfw, sfh; /* stored float geometry, used on mode revert */
-	int oldx, oldy, oldw, oldh;
-	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-	int bw, oldbw; // bar geomentry
-	unsigned int tags;
-	Bool isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, iscentred, isInSkipList;
-	Client *next;
-	Client *snext;
-	Monitor *mon;
-	Window win;
-};
-
 typedef struct {
 	int x, y, w, h;
     unsigned long colors[MAXCOLORS][ColLast];
 	Drawable drawable;
 	Drawable tabdrawable;
-	Drawable celldrawable; // TODO: leave it?
+	Drawable celldrawable; /* switcher cells, cellDC only; see drawswitcher() */
 	GC gc;
-	struct {
+	struct Fnt {
 		int ascent;
 		int descent;
 		int height;
 		XFontSet set;
 		XFontStruct *xfont;
+		struct {
+			wchar_t cp;   /* 0: empty */
+			int adv;
+		} glyphs[GLYPHCACHE];  /* direct mapped by codepoint */
 	} font;
 } DC; /* draw context */
 
@@ -153,49 +163,6 @@ typedef struct {
 	const Arg arg;
 } Key;
 
-typedef struct {
-	const char *symbol;
-	void (*arrange)(Monitor *);
-} Layout;
-
-
-// alttab client stack:
-const Client *clt[2];
-unsigned int selclt;
-
-struct Monitor {
-	char ltsymbol[16];
-	int num;
-	int by;               /* bar y location*/
-	int ty;               /* tab bar y location */
-	int mx, my, mw, mh;   /* screen size, as in total */
-	int wx, wy, ww, wh;   /* window area, ie where windows can be drawn  */
-	unsigned int seltags;
-	unsigned int sellt; // TODO: selected layout? saab olla 0 või 1
-	unsigned int tagset[2];
-	Bool showbar;
-	Bool showtab;
-	Bool topbar;
-	Bool toptab;
-	Client *clients;
-	Client *sel; // != focused!
-	Client *stack;
-	Monitor *next;
-	Window barwin;
-	Window tabwin;
-	Window cellwin; // alt+tab window
-	int ntabs;
-	int tab_widths[MAXTABS]; //TODO remove, as now all the tabs are of uniform width; // TODO: will be deprecated
-	const Layout *lt[2]; // TODO: contains current and previous layout???
-    // per monitor alttab client stack; we don't want per monitor, do we?
-	/*const Client *clt[2]; // TODO: contains current and previous selected clients???*/
-    /*unsigned int selclt;*/
-	int curtag; // TODO: shows which *view* we're currently in? (yup, should be that)
-	int prevtag;
-	const Layout **lts;
-	double *mfacts;
-	int *nmasters;
-};
 
  typedef struct {
 	const char *name;
@@ -220,35 +187,104 @@ struct Systray {
    Client *icons;
 };
 
+/* everything manage() reads from a window, fetched in one go by getprops() */
+typedef struct {
+	XWindowAttributes wa;
+	Bool hasattrs;
+	long wmstate;                       /* WM_STATE, -1 if unset */
+	char name[256];                     /* _NET_WM_NAME, else WM_NAME */
+	char class[256], instance[256];     /* WM_CLASS, broken if unset */
+	Window trans;
+	Bool hastrans;
+	Atom state, wtype;                  /* first atom of _NET_WM_STATE/_WINDOW_TYPE */
+	XSizeHints size;
+	Bool hassize;
+	XWMHints wmh;
+	Bool haswmh;
+} WinProps;
+
+typedef struct {
+	Window win;
+	void *data;
+} WinEntry;
+
+typedef struct {
+	WinEntry *tab;
+	unsigned int size;  /* power of two, 0 until first insert */
+	unsigned int count;
+} WinIndex; /* open addressing Window -> pointer map */
+
+typedef struct {
+	unsigned char cls[256];  /* byte -> input class, 0 for bytes in no pattern */
+	unsigned int nclasses;
+	unsigned int *delta;     /* state * nclasses + class -> next state, 0 is the root */
+	unsigned long *out;      /* RULEWORDS per state: rules whose pattern ends here */
+	unsigned char *term;     /* out of the state is not empty */
+	unsigned long *wild;     /* rules without a pattern for this field */
+} RuleMatcher; /* Aho-Corasick automaton over one field of rules[] */
+
+typedef struct {
+	char *str;            /* NULL: empty slot */
+	unsigned int hash;
+	unsigned int flags;   /* classflags() of str */
+	Client *mru, *lru;    /* clients whose resClass is str, see attachclass() */
+} InternEntry;
+
+typedef struct {
+	InternEntry *tab;
+	unsigned int size;    /* power of two, 0 until first insert */
+	unsigned int count;
+} InternTable; /* one copy of each client class string */
+
+typedef struct {
+	int pos;              /* compared with the dragged client's side */
+	int to;               /* its x or y when snapped here */
+	int lo, hi;           /* extent along the other axis */
+} SnapEdge;
+enum { EdgeLeft, EdgeRight, EdgeTop, EdgeBottom, EdgeLast }; /* side of the dragged client */
+
+#define CLIENTSLAB 64
+typedef struct ClientSlab ClientSlab;
+struct ClientSlab {
+	ClientSlab *next;
+	Client c[CLIENTSLAB];
+}; /* clients and systray icons are carved from these, see newclient() */
+
 /* function declarations */
-static void applyrules(Client *c);
-static Bool applysizehints(Client *c, int *x, int *y, int *w, int *h, Bool interact);
-static void arrange(Monitor *m);
-static void arrangemon(Monitor *m);
+static void applyrules(Client *c, const char *class, const char *instance);
 static void attach(Client *c);
 static void attachaside(Client *c);
+static void attachclass(Client *c);
 static void attachstack(Client *c);
+static void buildedges(Client *c);
 static void buttonpress(XEvent *e);
 static void checkotherwm(void);
 static void cleanup(void);
+static void coalesce(XEvent *q, int n);
 static void cleanupmon(Monitor *mon);
 static void clearurgent(Client *c);
+static unsigned long channelpixel(unsigned long mask, unsigned long v);
+static unsigned int classflags(const char *class);
 static void clientmessage(XEvent *e);
-static void configure(Client *c);
+static void crossmon(XCrossingEvent *ev, Monitor *m);
+static int cmpedge(const void *a, const void *b);
+static void compilerules(void);
 static void configurenotify(XEvent *e);
 static void configurerequest(XEvent *e);
 static Monitor *createmon(void);
-static void deck(Monitor *m);
 static void destroynotify(XEvent *e);
 static void detach(Client *c);
+static void detachclass(Client *c);
 static void detachstack(Client *c);
 static void die(const char *errstr, ...);
 static Monitor *dirtomon(int dir);
 static void drawbar(Monitor *m);
-static void drawbars(void);
 static void drawtab(Monitor *m);
-static void drawtabs(void);
-static void drawcoloredtext(char *text);
+static void drawtabcached(Client *c, unsigned long *col, int w);
+static Bool drawicon(Drawable d, Client *c, int slot, unsigned long bg, int x, int y);
+static void drawswitcher(Monitor *m, Client **cl, int n);
+static void drawCells(Drawable drawable, const char *text, unsigned long col[ColLast], Bool pad);
+static void drawcoloredtext(void);
 static void drawsquare(Bool filled, Bool empty, unsigned long col[ColLast]);
 static void drawpoint(Bool filled, unsigned long col[ColLast]);
 /*static void drawtext(const char *text, unsigned long col[ColLast], Bool pad);*/
@@ -258,9 +294,11 @@ static void enternotify_ffm(XEvent *e);
 static void toggle_ffm(void);
 static void toggle_mff(void);
 static void expose(XEvent *e);
+static void flushbars(void);
 static void focus(Client *c);
 static void focuswin(const Arg* arg);
 static void focusin(XEvent *e);
+static void freeclient(Client *c);
 /*static void altTab(const Arg *arg);*/
 static void altTab(void);
 static void hist_back(void);
@@ -268,10 +306,13 @@ static void hist_fwd(void);
 static void tab_back(void);
 static void tab_fwd(void);
 static void focusmon(const Arg *arg);
+static Bool issynergy(pid_t pid);
+static pid_t synergyserver(void);
 static void focusstack(const Arg *arg);
 static void focusstackwithoutrising(const Arg *arg);
 static void focusstackfloatingonly(const Arg *arg);
-static Atom getatomprop(Client *c, Atom prop);
+static Atom getatomprop(Window w, Atom prop);
+static void getprops(Window *wins, WinProps *wp, unsigned int n);
 static unsigned int getsystraywidth();
 static void removesystrayicon(Client *i);
 static void resizebarwin(Monitor *m);
@@ -280,32 +321,55 @@ static void restoreFloats(Client *c);
 static void resizerequest(XEvent *e);
 static unsigned long getcolor(const char *colstr);
 static Bool getrootptr(int *x, int *y);
+#ifndef XCB
 static long getstate(Window w);
+#endif /* XCB */
+#ifdef XSYNC
+static XSyncCounter getsynccounter(Client *c);
+#endif /* XSYNC */
 static Bool gettextprop(Window w, Atom atom, char *text, unsigned int size);
+static unsigned long *hinticon(Client *c, unsigned long *n);
 static void grabbuttons(Client *c, Bool focused);
 static void grabkeys(void);
 static void incnmaster(const Arg *arg);
 static void initfont(const char *fontstr);
+static const InternEntry *intern(const char *s);
+static InternEntry *internlookup(const char *s);
 static void keypress(XEvent *e);
-static void keyrelease(XEvent *e);
+static void loadicon(Client *c);
+static void loadstate(void);
 static void killclient(const Arg *arg);
-static void manage(Window w, XWindowAttributes *wa);
+static void manage(Window w, WinProps *wp);
+static int maskbits(unsigned long mask, int *shift);
+static void markdirty(Monitor *m, unsigned int regions);
 static void mappingnotify(XEvent *e);
 static void maprequest(XEvent *e);
-static void monocle(Monitor *m);
-static void motionnotify(XEvent *e);
+static void moveclients(Monitor *from, Monitor *to);
 static void movemouse(const Arg *arg);
+static long mstime(void);
+static Client *newclient(void);
 static Client *nexttiled(Client *c);
+#ifdef XRANDR
+static void parkmon(Monitor *m, Monitor *to);
+#endif /* XRANDR */
+static unsigned int pixelchannel(unsigned long mask, unsigned long px);
 static void pop(Client *);
 static void propertynotify(XEvent *e);
 static void quit(const Arg *arg);
+static void printstats(void);
 static Monitor *recttomon(int x, int y, int w, int h);
-static void resize(Client *c, int x, int y, int w, int h, Bool interact);
-static void resizeclient(Client *c, int x, int y, int w, int h);
+static Bool resizeevent(Display *d, XEvent *ev, XPointer arg);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *m);
+static const char *rulefield(const Rule *r, int field);
+static void rulescan(const RuleMatcher *rm, const char *s, unsigned long *hits);
+#ifdef XRANDR
+static void rrnotify(XEvent *e);
+#endif /* XRANDR */
 static void run(void);
 static void runorraise(const Arg *arg);
+static void restorestate(void);
+static void savestate(void);
 static void scan(void);
 static Bool sendevent(Window w, Atom proto, int m, long d0, long d1, long d2, long d3, long d4);
 static void updatesystray(void);
@@ -316,18 +380,27 @@ static void sendmon(Client *c, Monitor *m);
 static void setclientstate(Client *c, long state);
 static void setfocus(Client *c);
 static void setfullscreen(Client *c, Bool fullscreen);
+static void setsizehints(Client *c, XSizeHints *size);
+static void setwindowtype(Client *c, Atom state, Atom wtype);
+static void setwmhints(Client *c, XWMHints *wmh);
 static void setlayout(const Arg *arg);
 static void setcfact(const Arg *arg);
 static void resetcfactall(void);
 static void setmfact(const Arg *arg);
+static void setname(Client *c, const char *name);
 static void setup(void);
-static void showhide(Client *c);
+static void showcell(Monitor *m, int n, int i, Bool sel);
+static void skipenter(void);
+static void snapedge(int l, int v, int lo, int hi, int *to, int *best);
 static void sigchld(int unused);
+static void sigusr1(int unused);
 static void spawn(const Arg *arg);
+static unsigned int strhash(const char *s);
 static void tag(const Arg *arg);
 static void tagmon(const Arg *arg);
+static int textfit(struct Fnt *font, const char *text, unsigned int len, int max, unsigned int *fit);
 static int textnw(const char *text, unsigned int len);
-static void tile(Monitor *);
+static void textprop(XTextProperty *name, char *text, unsigned int size);
 static void togglebar(const Arg *arg);
 static void tabmode(const Arg *arg);
 static void togglefloating(const Arg *arg);
@@ -336,22 +409,33 @@ static void toggleview(const Arg *arg);
 static void unfocus(Client *c, Bool setfocus);
 static void unmanage(Client *c, Bool destroyed);
 static void unmapnotify(XEvent *e);
+#ifdef XRANDR
+static void unparkclients(Monitor *m);
+#endif /* XRANDR */
 static Bool updategeom(void);
+static void updatemons(void);
 static void updatebarpos(Monitor *m);
 static void updatebars(void);
 static void updatenumlockmask(void);
+#ifdef XRANDR
+static Bool updaterandr(void);
+#endif /* XRANDR */
 static void updatesizehints(Client *c);
 static void updatestatus(void);
 static void updatewindowtype(Client *c);
 static void updatetitle(Client *c);
-static void updateClassName(Client *c);
 static void updatewmhints(Client *c);
 static void view(const Arg *arg);
+static Client *visstep(Monitor *m, int l, Client *c, int dir);
+static void winindexdel(WinIndex *idx, Window w);
+static void *winindexget(WinIndex *idx, Window w);
+static void winindexput(WinIndex *idx, Window w, void *data);
 static Client *wintoclient(Window w);
 static Monitor *wintomon(Window w);
 static int xerror(Display *dpy, XErrorEvent *ee);
 static int xerrordummy(Display *dpy, XErrorEvent *ee);
 static int xerrorstart(Display *dpy, XErrorEvent *ee);
+static void xsync(void);
 static void zoom(const Arg *arg);
 static void raise_floating_client(Client *c);
 static void togglescratch(const Arg *arg);
@@ -362,6 +446,13 @@ static Systray *systray = NULL;
 static unsigned long systrayorientation = _NET_SYSTEM_TRAY_ORIENTATION_HORZ;
 static const char broken[] = "broken";
 static char stext[256];
+static char stbuf[sizeof stext];   /* stext split at its colour codes */
+static struct {
+	int col;                       /* index into dc.colors */
+	int off;                       /* start in stbuf */
+	int w;                         /* textnw() of the segment */
+} stseg[sizeof stext];
+static int nstseg, stextw;         /* segments and total width of stext */
 static int screen;
 static int sw, sh;           /* X display screen geometry width, height */
 static int bh, blw = 0;      /* bar geometry */
@@ -379,22 +470,54 @@ static void (*handler[LASTEvent]) (XEvent *) = {
 	[Expose] = expose,
 	[FocusIn] = focusin,
 	[KeyPress] = keypress,
-	/*[KeyRelease] = keyrelease, // TODO: for alttab hack*/
 	[MappingNotify] = mappingnotify,
 	[MapRequest] = maprequest,
-	[MotionNotify] = motionnotify,
 	[PropertyNotify] = propertynotify,
     [ResizeRequest] = resizerequest,
 	[UnmapNotify] = unmapnotify
 };
 static Atom wmatom[WMLast], netatom[NetLast], xatom[XLast];
 static Bool running = True;
+static volatile sig_atomic_t dumpstats = 0;
+static int curevent = 0;                 /* type of the event being handled */
+static unsigned long enterserial = 0;    /* EnterNotify below this is stale */
+#ifdef XSYNC
+static Bool hassync = False;             /* server has the SYNC extension */
+static int syncevbase;
+#endif /* XSYNC */
+#ifdef XRANDR
+static Bool hasrandr = False;            /* server has XRandR 1.5 monitors */
+static int rrevbase;
+#endif /* XRANDR */
+static pid_t synergypid = 0;           /* see synergyserver() */
+static int synergyfd = -1;               /* its pidfd */
+static struct {
+	unsigned long read;                  /* events taken off the queue */
+	unsigned long batches;
+	unsigned long coalesced[LASTEvent];  /* superseded before dispatch */
+	unsigned long syncs[LASTEvent];      /* round trips per handler */
+} evstats;
 static Cursor cursor[CurLast];
 static Display *dpy;
 static DC dc;
 static DC cellDC;
+static int iconsz[IconLast];  /* icon sizes for the bar, the tabs and the switcher */
+static XImage *iconimg;       /* drawicon()'s scratch */
 static Monitor *mons = NULL, *selmon = NULL;
+static Monitor *parked = NULL;           /* monitors whose output is gone, see parkmon() */
 static Window root;
+static WinIndex clientidx;   /* client windows -> Client */
+static WinIndex baridx;      /* bar, tab bar and cross windows -> Monitor */
+static WinIndex trayidx;     /* systray icon windows -> Client */
+static RuleMatcher rulematch[RuleLast];  /* rules[] compiled by compilerules() */
+static InternTable classes;   /* class strings of all clients, see intern() */
+static ClientSlab *slabs;     /* every Client ever allocated */
+static Client *freeclients;   /* unused entries of slabs, linked through next */
+static SnapEdge *edges[EdgeLast]; /* what movemouse() snaps to, see buildedges() */
+static int nedges[EdgeLast], edgesize;
+static WinIndex snapidx;     /* client windows -> _DWM_STATE record, during scan() */
+static long *snapshot = NULL;
+static Bool scanning = False;
 // these globals are used to store the target cursor coordinates when moved by the
 // transferPointerToNextMon(), so that moving focus could be ignored by enternotify();
 int txPointer_x = -1, txPointer_y = -1;
@@ -404,31 +527,46 @@ int txPointer_x = -1, txPointer_y = -1;
 #include "config.h"
 
 static unsigned int scratchtag = 1 << LENGTH(tags);
+static int tagw[LENGTH(tags)];  /* TEXTW() of each tag name, see setup() */
 
 /* compile-time check if all tags fit into an unsigned int bit array. */
 struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
 
+/* client geometry and the built-in layouts */
+#include "layout.c"
+#include "icon.c"
+
 /* function implementations */
 void
-applyrules(Client *c) {
-	const char *class, *instance;
-	unsigned int i;
+applyrules(Client *c, const char *class, const char *instance) {
+	const char *field[RuleLast];
+	unsigned long hits[RULEWORDS], match[RULEWORDS];
+	unsigned int i, f;
 	const Rule *r;
 	Monitor *m;
-	XClassHint ch = { NULL, NULL };
 
-	/* rule matching */
+	/* rule matching: one pass per field over the compiled patterns */
 	c->isfloating = c->tags = 0;
 	c->iscentred = 1;
-	XGetClassHint(dpy, c->win, &ch);
-	class    = ch.res_class ? ch.res_class : broken;
-	instance = ch.res_name  ? ch.res_name  : broken;
 
+	field[RuleClass] = class;
+	field[RuleInstance] = instance;
+	field[RuleTitle] = c->name;
+	for(i = 0; i < RULEWORDS; i++)
+		match[i] = ~0UL;
+	for(f = 0; f < RuleLast; f++) {
+		memcpy(hits, rulematch[f].wild, sizeof hits);
+		rulescan(&rulematch[f], field[f], hits);
+		for(i = 0; i < RULEWORDS; i++)
+			match[i] &= hits[i];
+	}
 	for(i = 0; i < LENGTH(rules); i++) {
+		if(!match[i / LONGBITS]) {
+			i |= LONGBITS - 1;
+			continue;
+		}
 		r = &rules[i];
-		if((!r->title || strstr(c->name, r->title))
-                && (!r->class || strstr(class, r->class))
-                && (!r->instance || strstr(instance, r->instance))) {
+		if(match[i / LONGBITS] & 1UL << i % LONGBITS) {
 			c->isfloating = r->isfloating;
 			c->iscentred = r->iscentred;
 			c->tags |= r->tags;
@@ -441,116 +579,17 @@ applyrules(Client *c) {
 				c->mon = m;
 		}
 	}
-    // TODO: modifications!
-	if(ch.res_class) {
-        /*fprintf(stderr, "    !applyrule: class \"%s\"\n", ch.res_class);*/
-		XFree(ch.res_class);
-    }
-
-	if(ch.res_name) {
-        /*fprintf(stderr, "    !applyrule: instance \"%s\"\n", ch.res_name);*/
-		XFree(ch.res_name);
-    }
-
 	/*if(c->name) {*/
         /*fprintf(stderr, "    !applyrule: title \"%s\"\n", c->name);*/
     /*}*/
 	c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
 }
 
-Bool
-applysizehints(Client *c, int *x, int *y, int *w, int *h, Bool interact) {
-	Bool baseismin;
-	Monitor *m = c->mon;
-
-	/* set minimum possible */
-	*w = MAX(1, *w);
-	*h = MAX(1, *h);
-	if(interact) {
-		if(*x > sw)
-			*x = sw - WIDTH(c);
-		if(*y > sh)
-			*y = sh - HEIGHT(c);
-		if(*x + *w + 2 * c->bw < 0)
-			*x = 0;
-		if(*y + *h + 2 * c->bw < 0)
-			*y = 0;
-	}
-	else {
-		if(*x >= m->wx + m->ww)
-			*x = m->wx + m->ww - WIDTH(c);
-		if(*y >= m->wy + m->wh)
-			*y = m->wy + m->wh - HEIGHT(c);
-		if(*x + *w + 2 * c->bw <= m->wx)
-			*x = m->wx;
-		if(*y + *h + 2 * c->bw <= m->wy)
-			*y = m->wy;
-	}
-	if(*h < bh)
-		*h = bh;
-	if(*w < bh)
-		*w = bh;
-	if(resizehints || c->isfloating || !c->mon->lt[c->mon->sellt]->arrange) {
-		/* see last two sentences in ICCCM 4.1.2.3 */
-		baseismin = c->basew == c->minw && c->baseh == c->minh;
-		if(!baseismin) { /* temporarily remove base dimensions */
-			*w -= c->basew;
-			*h -= c->baseh;
-		}
-		/* adjust for aspect limits */
-		if(c->mina > 0 && c->maxa > 0) {
-			if(c->maxa < (float)*w / *h)
-				*w = *h * c->maxa + 0.5;
-			else if(c->mina < (float)*h / *w)
-				*h = *w * c->mina + 0.5;
-		}
-		if(baseismin) { /* increment calculation requires this */
-			*w -= c->basew;
-			*h -= c->baseh;
-		}
-		/* adjust for increment value */
-		if(c->incw)
-			*w -= *w % c->incw;
-		if(c->inch)
-			*h -= *h % c->inch;
-		/* restore base dimensions */
-		*w = MAX(*w + c->basew, c->minw);
-		*h = MAX(*h + c->baseh, c->minh);
-		if(c->maxw)
-			*w = MIN(*w, c->maxw);
-		if(c->maxh)
-			*h = MIN(*h, c->maxh);
-	}
-	return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
-}
-
-void
-arrange(Monitor *m) {
-	if(m)
-		showhide(m->stack);
-	else for(m = mons; m; m = m->next)
-		showhide(m->stack);
-	if(m)
-		arrangemon(m);
-	else for(m = mons; m; m = m->next)
-		arrangemon(m);
-}
-
-void
-arrangemon(Monitor *m) {
-	updatebarpos(m);
-	XMoveResizeWindow(dpy, m->tabwin, m->wx, m->ty, m->ww, th);
-
-	strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
-	if(m->lt[m->sellt]->arrange) // TODO: kontrollib, kas layoutil on funktsioon olemas? (floatil funktsioon puudub)
-		m->lt[m->sellt]->arrange(m); // siin kutsutakse konkreetset lyt meetodit vist välja?
-	restack(m);
-}
-
 void
 attach(Client *c) {
 	c->next = c->mon->clients;
 	c->mon->clients = c;
+	c->mon->visdirty = True;
 }
 
 void
@@ -562,6 +601,21 @@ attachaside(Client *c) {
 	}
 	c->next = at->next;
     at->next = c;
+	c->mon->visdirty = True;
+}
+
+/* most recently focused first in the list of its class */
+void
+attachclass(Client *c) {
+	InternEntry *e = internlookup(c->resClass);
+
+	c->cprev = NULL;
+	c->cnext = e->mru;
+	if(e->mru)
+		e->mru->cprev = c;
+	else
+		e->lru = c;
+	e->mru = c;
 }
 
 void
@@ -570,6 +624,75 @@ attachstack(Client *c) {
 	c->mon->stack = c;
 }
 
+/* indexes the edges c can snap to: those of the other visible clients
+ * on its monitor and of the work area, each list sorted by pos.  The
+ * offsets mirror what movemouse() always did: client edges compare with
+ * c's inner size, the work area with its outer size. */
+void
+buildedges(Client *c) {
+	Monitor *m = c->mon;
+	Client *cc;
+	SnapEdge *e;
+	int n, l;
+
+	for(n = 1, cc = m->clients; cc; cc = cc->next)
+		n += cc != c && ISVISIBLE(cc);
+	if(n > edgesize) {
+		free(edges[0]);
+		edgesize = MAX(n, 2 * edgesize);
+		if(!(edges[0] = malloc(EdgeLast * edgesize * sizeof(SnapEdge))))
+			die("fatal: could not malloc() %u bytes\n", EdgeLast * edgesize * sizeof(SnapEdge));
+		for(l = 1; l < EdgeLast; l++)
+			edges[l] = edges[0] + l * edgesize;
+	}
+	for(l = 0; l < EdgeLast; l++)
+		nedges[l] = 0;
+	for(cc = m->clients; cc; cc = cc->next) {
+		if(cc == c || !ISVISIBLE(cc))
+			continue;
+		e = &edges[EdgeLeft][nedges[EdgeLeft]++];    /* right side of cc */
+		e->pos = cc->x + cc->w;
+		e->to = e->pos + 2 * c->bw;
+		e->lo = cc->y;
+		e->hi = cc->y + HEIGHT(cc);
+		e = &edges[EdgeRight][nedges[EdgeRight]++];  /* left side of cc */
+		e->pos = cc->x;
+		e->to = cc->x - c->w - 2 * c->bw;
+		e->lo = cc->y;
+		e->hi = cc->y + HEIGHT(cc);
+		e = &edges[EdgeTop][nedges[EdgeTop]++];      /* bottom of cc */
+		e->pos = cc->y + cc->h;
+		e->to = e->pos + 2 * c->bw;
+		e->lo = cc->x;
+		e->hi = cc->x + WIDTH(cc);
+		e = &edges[EdgeBottom][nedges[EdgeBottom]++]; /* top of cc */
+		e->pos = cc->y;
+		e->to = cc->y - c->h - 2 * c->bw;
+		e->lo = cc->x;
+		e->hi = cc->x + WIDTH(cc);
+	}
+	e = &edges[EdgeLeft][nedges[EdgeLeft]++];
+	e->pos = e->to = m->wx;
+	e->lo = m->wy;
+	e->hi = m->wy + m->wh;
+	e = &edges[EdgeRight][nedges[EdgeRight]++];
+	e->pos = m->wx + m->ww - 2 * c->bw;
+	e->to = m->wx + m->ww - WIDTH(c);
+	e->lo = m->wy;
+	e->hi = m->wy + m->wh;
+	e = &edges[EdgeTop][nedges[EdgeTop]++];
+	e->pos = e->to = m->wy;
+	e->lo = m->wx;
+	e->hi = m->wx + m->ww;
+	e = &edges[EdgeBottom][nedges[EdgeBottom]++];
+	e->pos = m->wy + m->wh - 2 * c->bw;
+	e->to = m->wy + m->wh - HEIGHT(c);
+	e->lo = m->wx;
+	e->hi = m->wx + m->ww;
+	for(l = 0; l < EdgeLast; l++)
+		qsort(edges[l], nedges[l], sizeof(SnapEdge), cmpedge);
+}
+
 void
 buttonpress(XEvent *e) {
 	unsigned int i, x, click;
@@ -588,7 +711,7 @@ buttonpress(XEvent *e) {
 	if(ev->window == selmon->barwin) {
 		i = x = 0;
 		do
-			x += TEXTW(tags[i].name);
+			x += tagw[i];
        while(ev->x >= x && ++i < (LENGTH(tags) - 1));
        if(i < (LENGTH(tags) - 1)) {
 			click = ClkTagBar;
@@ -596,7 +719,7 @@ buttonpress(XEvent *e) {
 		}
 		else if(ev->x < x + blw)
 			click = ClkLtSymbol;
-		else if(ev->x > selmon->ww - TEXTW(stext))
+		else if(ev->x > selmon->ww - (stextw + dc.font.height))
 			click = ClkStatusText;
 		else
 			click = ClkWinTitle;
@@ -653,40 +776,37 @@ void sendKey2(KeySym keysym, KeySym modsym) {
         /*[>XTestFakeKeyEvent (dpy, modcode, False, 0);<]*/
     /*[>}<]*/
 
-    XSync (dpy, False);
+    xsync();
     XTestGrabControl (dpy, False);
 }
-void sendKey(KeySym keysym, KeySym modsym) {
-    KeyCode keycode = 0, modcode = 0;
-
-    /*Display* dpy;*/
-	/*dpy = XOpenDisplay(NULL);*/
-    keycode = XKeysymToKeycode (dpy, keysym);
-
-	fprintf(stderr, "keycode: %d\n", keycode);
-
-    if (keycode == 0) return;
-    XTestGrabControl (dpy, True);
-    //[> Generate modkey press <]
-    if (modsym != 0) {
-        modcode = XKeysymToKeycode(dpy, modsym);
-        XTestFakeKeyEvent (dpy, modcode, True, CurrentTime);
-        XFlush(dpy);
-    }
-    //[> Generate regular key press and release <]
-    XTestFakeKeyEvent (dpy, keycode, True, CurrentTime);
-        XFlush(dpy);
-    XTestFakeKeyEvent (dpy, keycode, False, CurrentTime);
-        XFlush(dpy);
-
-    //[> Generate modkey release <]
-    if (modsym != 0) {
-        XTestFakeKeyEvent (dpy, modcode, False, CurrentTime);
-        XFlush(dpy);
-    }
+/* types keysym with the modifiers in mask held down, after letting go of
+ * the nup keys in up[] that the binding that got us here still holds.
+ * Through XTest rather than XSendEvent, so that passive grabs of other
+ * clients (synergy's hotkeys) fire as if it was typed. */
+void
+sendKey(const KeySym *up, int nup, KeySym keysym, unsigned int mask) {
+	static const struct { unsigned int mask; KeySym sym; } mods[] = {
+		{ Mod4Mask, XK_Super_L }, { ControlMask, XK_Control_L },
+		{ Mod1Mask, XK_Alt_L }, { ShiftMask, XK_Shift_L },
+	};
+	KeyCode keycode;
+	int i;
 
-    XSync (dpy, False);
-    XTestGrabControl (dpy, False);
+	if(!(keycode = XKeysymToKeycode(dpy, keysym)))
+		return;
+	XTestGrabControl(dpy, True);
+	for(i = 0; i < nup; i++)
+		XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, up[i]), False, CurrentTime);
+	for(i = 0; i < LENGTH(mods); i++)
+		if(mask & mods[i].mask)
+			XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, mods[i].sym), True, CurrentTime);
+	XTestFakeKeyEvent(dpy, keycode, True, CurrentTime);
+	XTestFakeKeyEvent(dpy, keycode, False, CurrentTime);
+	for(i = LENGTH(mods) - 1; i >= 0; i--)
+		if(mask & mods[i].mask)
+			XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, mods[i].sym), False, CurrentTime);
+	XTestGrabControl(dpy, False);
+	XFlush(dpy);
 }
 
 void sendKeyEvent(KeySym key, unsigned int mask, unsigned int pressOrReleaseMask) {
@@ -724,7 +844,7 @@ void sendKeyEvent(KeySym key, unsigned int mask, unsigned int pressOrReleaseMask
     XSendEvent(dpy, w, True, KeyPressMask|KeyReleaseMask, (XEvent *)&e);
     /*XSendEvent(dpy, w, True, KeyPressMask, (XEvent *)&e);*/
     /*XTestFakeKeyEvent(dpy, KeyPressMask, (XEvent *)&e);*/
-    XSync (dpy, False);
+    xsync();
 }
 
 void
@@ -742,6 +862,8 @@ cleanup(void) {
 	Arg a = {.ui = ~0};
 	Layout foo = { "", NULL };
 	Monitor *m;
+	ClientSlab *s;
+	int i;
 
 	view(&a);
 	selmon->lt[selmon->sellt] = &foo;
@@ -760,12 +882,14 @@ cleanup(void) {
 
 	XFreePixmap(dpy, dc.drawable);
 	XFreePixmap(dpy, dc.tabdrawable);
-	XFreePixmap(dpy, dc.celldrawable);
 	XFreeGC(dpy, dc.gc);
-	XFreePixmap(dpy, cellDC.drawable);
-	XFreePixmap(dpy, cellDC.tabdrawable);
-	XFreePixmap(dpy, cellDC.celldrawable);
-	XFreeGC(dpy, cellDC.gc);
+	/* the rest of cellDC is dc's */
+	if(cellDC.celldrawable)
+		XFreePixmap(dpy, cellDC.celldrawable);
+	if(iconimg)
+		XDestroyImage(iconimg);
+	if(synergyfd >= 0)
+		close(synergyfd);
 
 	XFreeCursor(dpy, cursor[CurNormal]);
 	XFreeCursor(dpy, cursor[CurMove]);
@@ -780,31 +904,56 @@ cleanup(void) {
 	XFreeCursor(dpy, cursor[CurRzDnCorRight]);
 	while(mons)
 		cleanupmon(mons);
+	while(parked)
+		cleanupmon(parked);
     if(showsystray) {
         XUnmapWindow(dpy, systray->win);
         XDestroyWindow(dpy, systray->win);
         free(systray);
     }
+	free(clientidx.tab);
+	free(baridx.tab);
+	free(trayidx.tab);
+	for(i = 0; i < classes.size; i++)
+		free(classes.tab[i].str);
+	free(classes.tab);
+	free(edges[0]);
+	while(slabs) {
+		s = slabs->next;
+		free(slabs);
+		slabs = s;
+	}
+	for(i = 0; i < RuleLast; i++) {
+		free(rulematch[i].wild);
+		free(rulematch[i].delta);
+		free(rulematch[i].out);
+		free(rulematch[i].term);
+	}
 	XSync(dpy, False);
 	XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
 }
 
 void
 cleanupmon(Monitor *mon) {
-	Monitor *m;
-
-	if(mon == mons)
-		mons = mons->next;
-	else {
-		for(m = mons; m && m->next != mon; m = m->next);
-		m->next = mon->next;
-	}
-	XUnmapWindow(dpy, mon->barwin);
-	XDestroyWindow(dpy, mon->barwin);
-	XUnmapWindow(dpy, mon->tabwin);
-	XDestroyWindow(dpy, mon->tabwin);
-	XUnmapWindow(dpy, mon->cellwin);
-	XDestroyWindow(dpy, mon->cellwin);
+	Monitor **mp;
+
+	for(mp = &mons; *mp && *mp != mon; mp = &(*mp)->next);
+	if(!*mp) /* parked */
+		for(mp = &parked; *mp != mon; mp = &(*mp)->next);
+	*mp = mon->next;
+	if(mon->barwin) {
+		winindexdel(&baridx, mon->barwin);
+		winindexdel(&baridx, mon->tabwin);
+		XUnmapWindow(dpy, mon->barwin);
+		XDestroyWindow(dpy, mon->barwin);
+		XUnmapWindow(dpy, mon->tabwin);
+		XDestroyWindow(dpy, mon->tabwin);
+		XUnmapWindow(dpy, mon->cellwin);
+		XDestroyWindow(dpy, mon->cellwin);
+		winindexdel(&baridx, mon->crosswin);
+		XDestroyWindow(dpy, mon->crosswin);
+	}
+	free(mon->vis[0]);
 	free(mon->mfacts);
 	free(mon->nmasters);
 	free(mon->lts);
@@ -823,6 +972,20 @@ clearurgent(Client *c) {
 	XFree(wmh);
 }
 
+/* flags that only depend on the class string, worked out once per
+ * distinct class by intern() */
+unsigned int
+classflags(const char *class) {
+	unsigned int i, flags = 0;
+
+	for(i = 0; i < LENGTH(ignored_class_list); i++)
+		if(strstr(class, ignored_class_list[i]))
+			flags |= ClassSkip;
+	if(strstr(class, client_class_idea))
+		flags |= ClassIdea;
+	return flags;
+}
+
 void
 clientmessage(XEvent *e) {
     XWindowAttributes wa;
@@ -833,12 +996,12 @@ clientmessage(XEvent *e) {
    if(showsystray && cme->window == systray->win && cme->message_type == netatom[NetSystemTrayOP]) {
        /* add systray icons */
        if(cme->data.l[1] == SYSTEM_TRAY_REQUEST_DOCK) {
-           if(!(c = (Client *)calloc(1, sizeof(Client))))
-               die("fatal: could not malloc() %u bytes\n", sizeof(Client));
+           c = newclient();
            c->win = cme->data.l[2];
            c->mon = selmon;
            c->next = systray->icons;
            systray->icons = c;
+           winindexput(&trayidx, c->win, c);
            XGetWindowAttributes(dpy, c->win, &wa);
            c->x = c->oldx = c->y = c->oldy = 0;
            c->w = c->oldw = wa.width;
@@ -862,8 +1025,7 @@ clientmessage(XEvent *e) {
            sendevent(c->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_FOCUS_IN, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
            sendevent(c->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_WINDOW_ACTIVATE, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
            sendevent(c->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_MODALITY_ON, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
-           resizebarwin(selmon);
-           updatesystray();
+           markdirty(selmon, DirtySystray);
            setclientstate(c, NormalState);
        }
        return;
@@ -882,8 +1044,7 @@ clientmessage(XEvent *e) {
 
             XSetWindowBorder(dpy, c->win, dc.colors[ColUrg][ColBorder]);
 			/*updatewmhints(c);*/
-			drawbars();
-			drawtabs();
+			markdirty(c->mon, DirtyTags);
         }
 	}
     // TODO:
@@ -897,55 +1058,101 @@ clientmessage(XEvent *e) {
 	/*}*/
 }
 
+int
+cmpedge(const void *a, const void *b) {
+	return ((const SnapEdge *)a)->pos - ((const SnapEdge *)b)->pos;
+}
+
+/* builds one Aho-Corasick automaton per rule field, so that applyrules()
+ * finds every matching rule in a single pass over each string */
 void
-configure(Client *c) {
-	XConfigureEvent ce;
+compilerules(void) {
+	const unsigned char *p;
+	unsigned int f, i, j, k, n, r, s, nstates, head, tail, *fail, *queue;
+	RuleMatcher *rm;
+
+	for(f = 0; f < RuleLast; f++) {
+		rm = &rulematch[f];
+		if(!(rm->wild = calloc(RULEWORDS, sizeof(unsigned long))))
+			die("fatal: could not malloc() %u bytes\n", RULEWORDS * sizeof(unsigned long));
+		/* an input class per byte that occurs in some pattern, and
+		 * n, one more than the pattern bytes, bounds the states */
+		rm->nclasses = 1;
+		for(n = 1, i = 0; i < LENGTH(rules); i++) {
+			if(!(p = (const unsigned char *)rulefield(&rules[i], f)) || !*p) {
+				rm->wild[i / LONGBITS] |= 1UL << i % LONGBITS;
+				continue;
+			}
+			for(; *p; p++, n++)
+				if(!rm->cls[*p])
+					rm->cls[*p] = rm->nclasses++;
+		}
+		k = rm->nclasses;
+		if(!(rm->delta = calloc(n * k + 2 * n, sizeof(unsigned int))))
+			die("fatal: could not malloc() %u bytes\n", (n * k + 2 * n) * sizeof(unsigned int));
+		if(!(rm->out = calloc(n * RULEWORDS, sizeof(unsigned long))))
+			die("fatal: could not malloc() %u bytes\n", n * RULEWORDS * sizeof(unsigned long));
+		if(!(rm->term = calloc(n, 1)))
+			die("fatal: could not malloc() %u bytes\n", n);
+		fail = rm->delta + n * k;
+		queue = fail + n;
+
+		/* trie of the patterns; edges never lead back to the root, so 0
+		 * marks a missing one until the failure pass fills it in */
+		for(nstates = 1, i = 0; i < LENGTH(rules); i++) {
+			if(!(p = (const unsigned char *)rulefield(&rules[i], f)) || !*p)
+				continue;
+			for(s = 0; *p; p++) {
+				if(!rm->delta[s * k + rm->cls[*p]])
+					rm->delta[s * k + rm->cls[*p]] = nstates++;
+				s = rm->delta[s * k + rm->cls[*p]];
+			}
+			rm->out[s * RULEWORDS + i / LONGBITS] |= 1UL << i % LONGBITS;
+			rm->term[s] = 1;
+		}
 
-	ce.type = ConfigureNotify;
-	ce.display = dpy;
-	ce.event = c->win;
-	ce.window = c->win;
-	ce.x = c->x;
-	ce.y = c->y;
-	ce.width = c->w;
-	ce.height = c->h;
-	ce.border_width = c->bw;
-	ce.above = None;
-	ce.override_redirect = False;
-	XSendEvent(dpy, c->win, False, StructureNotifyMask, (XEvent *)&ce);
+		/* failure links breadth first, folded into delta so that
+		 * matching takes exactly one transition per byte */
+		for(head = tail = 0, j = 0; j < k; j++)
+			if((s = rm->delta[j]))
+				queue[tail++] = s;
+		while(head < tail) {
+			r = queue[head++];
+			for(j = 0; j < k; j++) {
+				if(!(s = rm->delta[r * k + j])) {
+					rm->delta[r * k + j] = rm->delta[fail[r] * k + j];
+					continue;
+				}
+				fail[s] = rm->delta[fail[r] * k + j];
+				for(i = 0; i < RULEWORDS; i++)
+					rm->out[s * RULEWORDS + i] |= rm->out[fail[s] * RULEWORDS + i];
+				rm->term[s] |= rm->term[fail[s]];
+				queue[tail++] = s;
+			}
+		}
+	}
 }
 
 void
 configurenotify(XEvent *e) {
 	Monitor *m;
 	XConfigureEvent *ev = &e->xconfigure;
-	Bool dirty;
 
 	if(ev->window == root) {
-		dirty = (sw != ev->width);
-		sw = ev->width;
-		sh = ev->height;
-		if(updategeom() || dirty) {
+		if(sw != ev->width) {
+			sw = ev->width;
 			if(dc.drawable != 0)
 				XFreePixmap(dpy, dc.drawable);
 			dc.drawable = XCreatePixmap(dpy, root, sw, bh, DefaultDepth(dpy, screen));
 			if(dc.tabdrawable != 0)
 				XFreePixmap(dpy, dc.tabdrawable);
 			dc.tabdrawable = XCreatePixmap(dpy, root, sw, th, DefaultDepth(dpy, screen));
-            // TODO: is this necessary?
-			if(dc.celldrawable != 0)
-				XFreePixmap(dpy, dc.celldrawable);
-            // TODO: cw, ch??? (cwch asendasin praegu 10-ga)
-			dc.celldrawable = XCreatePixmap(dpy, root, cellWidth, 10, DefaultDepth(dpy, screen));
-			/*dc.celldrawable = XCreatePixmap(dpy, root, cw, ch, DefaultDepth(dpy, screen));*/
-
-			updatebars();
-			for(m = mons; m; m = m->next){
-                resizebarwin(m);
-			}
-			focus(NULL);
-			arrange(NULL);
+			for(m = mons; m; m = m->next)
+				markdirty(m, DirtyAll);
 		}
+		sh = ev->height;
+		if(updategeom())
+			updatemons();
 	}
 }
 
@@ -999,7 +1206,6 @@ configurerequest(XEvent *e) {
 		wc.stack_mode = ev->detail;
 		XConfigureWindow(dpy, ev->window, ev->value_mask, &wc);
 	}
-	XSync(dpy, False);
 }
 
 Monitor *
@@ -1024,6 +1230,7 @@ createmon(void) {
 	m->topbar = topbar;
 	m->toptab = toptab;
 	m->ntabs = 0;
+	m->visdirty = True;
 	m->curtag = m->prevtag = 1;
 	for(i = 1; i < numtags; i++) {
 		m->mfacts[i] = tags[i - 1].mfact < 0 ? mfact : tags[i - 1].mfact;
@@ -1037,76 +1244,21 @@ createmon(void) {
 	return m;
 }
 
+/* the pointer came onto the bare root of m.  As root motion tracking
+ * did, selmon follows once the monitor under the bare root changes, not
+ * merely because the pointer came back off a window after focusmon() */
 void
-deck(Monitor *m) {
-	int dn;
-	unsigned int i, n, h, mw, my, r;
-	Client *c;
-	float mfacts = 0, sfacts = 0;
+crossmon(XCrossingEvent *ev, Monitor *m) {
+	static Monitor *last = NULL;
 
-	for(n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
-		if(n < m->nmasters[m->curtag])
-			mfacts += c->cfact;
-		/*else*/
-			/*sfacts += c->cfact;*/
-    }
-
-	if(n == 0)
+	if(ev->mode != NotifyNormal)
 		return;
-
-	dn = n - m->nmasters[m->curtag]; // count of stacked slaves, ie clients in deck
-
-	if(dn > 0) /* override layout symbol */
-		snprintf(m->ltsymbol, sizeof m->ltsymbol, " D %d", dn);
-
-	if(n > m->nmasters[m->curtag])
-		mw = m->nmasters[m->curtag] ? m->ww * m->mfacts[m->curtag] : 0;
-	else
-		mw = m->ww;
-	for(i = my = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++, r = 0)
-        // TODO:
-		/*if(n == 1) {*/
-			/*if (c->bw) {*/
-				/*[> remove border when only one window is on the current tag <]*/
-				/*c->oldbw = c->bw;*/
-				/*c->bw = 0;*/
-				/*r = 1;*/
-			/*}*/
-		/*}*/
-		/*else if(!c->bw && c->oldbw) {*/
-			/*[> restore border when more than one window is displayed <]*/
-			/*c->bw = c->oldbw;*/
-			/*c->oldbw = 0;*/
-			/*r = 1;*/
-		/*}*/
-
-		if(i < m->nmasters[m->curtag]) {
-            h = (m->wh - my) * (c->cfact / mfacts); // oli enne
-			resize(c,
-                   m->wx,
-                   m->wy + my,
-                   mw - (2*c->bw),
-                   h - (2*c->bw),    False);
-			/*if(r)*/
-				/*resizeclient(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw));*/
-			my += HEIGHT(c);
-			mfacts -= c->cfact;
-
-            // before:
-			/*h = (m->wh - my) / (MIN(n, m->nmasters[m->curtag]) - i);*/
-			/*resize(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw), False);*/
-            /*
-			 *if(r)
-			 *    resizeclient(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw));
-             */
-			/*my += HEIGHT(c);*/
-		}
-		else
-			resize(c, m->wx + mw, m->wy, m->ww - mw - (2*c->bw), m->wh - (2*c->bw), False);
-            /*
-			 *if(r)
-			 *    resizeclient(c, m->wx + mw, m->wy, m->ww - mw - (2*c->bw), m->wh - (2*c->bw));
-             */
+	if(m != last && last && m != selmon) {
+		unfocus(selmon->sel, True);
+		selmon = m;
+		focus(NULL);
+	}
+	last = m;
 }
 
 void
@@ -1118,8 +1270,7 @@ destroynotify(XEvent *e) {
 		unmanage(c, True);
     else if((c = wintosystrayicon(ev->window))) {
        removesystrayicon(c);
-       resizebarwin(selmon);
-       updatesystray();
+       markdirty(selmon, DirtySystray);
    }
 }
 
@@ -1129,6 +1280,22 @@ detach(Client *c) {
 
 	for(tc = &c->mon->clients; *tc && *tc != c; tc = &(*tc)->next);
 	*tc = c->next;
+	c->mon->visdirty = True;
+}
+
+void
+detachclass(Client *c) {
+	InternEntry *e = internlookup(c->resClass);
+
+	if(c->cprev)
+		c->cprev->cnext = c->cnext;
+	else
+		e->mru = c->cnext;
+	if(c->cnext)
+		c->cnext->cprev = c->cprev;
+	else
+		e->lru = c->cprev;
+	c->cnext = c->cprev = NULL;
 }
 
 void
@@ -1192,15 +1359,29 @@ dirtomon_synergy(int dir) {
 	/*return m;*/
 }
 
+/* record the painted span [x, x+w) of a bar, merging it with the previous one
+ * when adjacent; the drawable is shared, so only painted spans may be copied */
+static void
+addspan(int *sx, int *sw, int *n, int x, int w) {
+	if(w <= 0)
+		return;
+	if(*n && sx[*n - 1] + sw[*n - 1] == x)
+		sw[*n - 1] += w;
+	else {
+		sx[*n] = x;
+		sw[(*n)++] = w;
+	}
+}
+
 void
 drawbar(Monitor *m) {
-	int x;
+	int x, sx[4], sw[4], n = 0;
+	int stx, stw;
 	unsigned int i, occ = 0, urg = 0;
 	unsigned long *col;
 	unsigned int a = 0, s = 0;
 	Client *c;
 
-    resizebarwin(m);
 	for(c = m->clients; c; c = c->next) {
 		occ |= c->tags;
 		if(c->isurgent)
@@ -1208,7 +1389,11 @@ drawbar(Monitor *m) {
 	}
 	dc.x = 0;
     for(i = 0; i < (LENGTH(tags) - 1); i++) {
-		dc.w = TEXTW(tags[i].name);
+		dc.w = tagw[i];
+		if(!(m->dirty & DirtyTags)) {
+			dc.x += dc.w;
+			continue;
+		}
         /*col = dc.colors[ (m->tagset[m->seltags] & 1 << i) ? 1 : (urg & 1 << i ? 2:(occ & 1 << i ? occupiedColorIndex:0)) ];*/
         col = dc.colors[
             (m->tagset[m->seltags] & 1 << i)
@@ -1227,107 +1412,96 @@ drawbar(Monitor *m) {
             drawpoint(False, dc.colors[occupiedColorIndex]);
 		dc.x += dc.w;
 	}
-	if(m->lt[m->sellt]->arrange == monocle) {
-		for(a = 0, s = 0, c= nexttiled(m->clients); c; c= nexttiled(c->next), a++)
-			if(c == m->stack)
+	if(m->dirty & DirtyTags)
+		addspan(sx, sw, &n, 0, dc.x);
+	if(m->dirty & DirtyLtSymbol && m->lt[m->sellt]->arrange == monocle) {
+		updatevis(m);
+		for(a = 0, s = 0; a < m->nvis[ListTiled]; a++)
+			if(m->vis[ListTiled][a] == m->stack)
 				s = a;
 		if(!s && a)
 			s = a;
 		snprintf(m->ltsymbol, sizeof m->ltsymbol, "[%d/%d]", s, a);
 	}
 	dc.w = blw = TEXTW(m->ltsymbol);
-	/*drawtext(m->ltsymbol, dc.colors[6], False);*/
-	drawtext(dc.drawable, m->ltsymbol, dc.colors[6], False);
+	if(m->dirty & DirtyLtSymbol) {
+		/*drawtext(m->ltsymbol, dc.colors[6], False);*/
+		drawtext(dc.drawable, m->ltsymbol, dc.colors[6], False);
+		addspan(sx, sw, &n, dc.x, dc.w);
+	}
 	dc.x += dc.w;
 	x = dc.x;
 	if(m == selmon) { /* status is only drawn on selected monitor */
-        dc.w = textnw(stext, strlen(stext)); // no padding
-		dc.x = m->ww - dc.w;
+        stw = stextw; // no padding
+		stx = m->ww - stw;
        if(showsystray && m == selmon) {
-           dc.x -= getsystraywidth();
+           stx -= getsystraywidth();
        }
-		if(dc.x < x) {
-			dc.x = x;
-			dc.w = m->ww - x;
+		if(stx < x) {
+			stx = x;
+			stw = m->ww - x;
+		}
+		if(m->dirty & DirtyStatus) {
+			dc.x = stx;
+			dc.w = stw;
+			drawcoloredtext();
 		}
-        drawcoloredtext(stext);
 	}
 	else
-		dc.x = m->ww;
-	if((dc.w = dc.x - x) > bh) {
+		stx = m->ww;
+	/* the title fills whatever the layout symbol and status leave over */
+	if(m->titlex != x || m->titlew != stx - x) {
+		m->titlex = x;
+		m->titlew = stx - x;
+		m->dirty |= DirtyTitle;
+	}
+	if(m->dirty & DirtyTitle && (dc.w = stx - x) > bh) {
 		dc.x = x;
 		if(m->sel) {
         col = dc.colors[ m == selmon ? 1 : 0 ];
         // TODO: here is a fishy place
+        drawtext(dc.drawable, NULL, col, False);
+        if(drawicon(dc.drawable, m->sel, IconBar, col[ColBG], x + (bh - iconsz[IconBar]) / 2,
+                    (bh - iconsz[IconBar]) / 2)) {
+            dc.x += bh;
+            dc.w -= bh;
+        }
         drawtext(dc.drawable, m->sel->name, col, True);
+        dc.x = x;
+        dc.w = stx - x;
         // potentially this needed:
         /*drawtext(dc.drawable, m->sel->name, dc.colors[0], True);*/
 		}
 		else
 			drawtext(dc.drawable, NULL, dc.colors[0], False);
+		addspan(sx, sw, &n, x, dc.w);
 	}
-	XCopyArea(dpy, dc.drawable, m->barwin, dc.gc, 0, 0, m->ww, bh, 0, 0);
-	XSync(dpy, False);
-}
-
-void
-drawbars(void) {
-	Monitor *m;
-
-	for(m = mons; m; m = m->next)
-		drawbar(m);
-    updatesystray();
+	if(m == selmon && m->dirty & DirtyStatus)
+		addspan(sx, sw, &n, stx, m->ww - stx);
+	for(i = 0; i < n; i++)
+		XCopyArea(dpy, dc.drawable, m->barwin, dc.gc, sx[i], 0, sw[i], bh, sx[i], 0);
 }
 
 void
-drawcoloredtext(char *text) {
-    char *buf = text, *ptr = buf, c = 1;
-    unsigned long *col = dc.colors[0];
-    int i, ox = dc.x;
-
-    while( *ptr ) {
-    for( i = 0; *ptr < 0 || *ptr > NUMCOLORS; i++, ptr++);
-        if( !*ptr ) break;
-        c=*ptr;
-        *ptr=0;
-            if( i ) {
-            dc.w = selmon->ww - dc.x;
-            drawtext(dc.drawable, buf, col, False);
-            dc.x += textnw(buf, i);
-            }
-        *ptr = c;
-        col = dc.colors[ c-1 ];
-        buf = ++ptr;
-        }
-    drawtext(dc.drawable, buf, col, False);
-    dc.x = ox;
-}
-
-drawtabs(void) {
-   Monitor *m;
+drawcoloredtext(void) {
+	int i, ox = dc.x;
 
-   for(m = mons; m; m = m->next)
-       drawtab(m);
-}
-
-static int
-cmpint(const void *p1, const void *p2) {
-  /* The actual arguments to this function are "pointers to
-     pointers to char", but strcmp(3) arguments are "pointers
-     to char", hence the following cast plus dereference */
-  return *((int*) p1) > * (int*) p2;
+	for(i = 0; i < nstseg; i++) {
+		dc.w = selmon->ww - dc.x;
+		drawtext(dc.drawable, stbuf + stseg[i].off, dc.colors[stseg[i].col], False);
+		dc.x += stseg[i].w;
+	}
+	dc.x = ox;
 }
 
-
 void
 drawtab(Monitor *m) {
    unsigned long *col;
    Client *c;
    int i;
    int itag = -1;
-   char view_info[50];
+   char view_info[50] = "";
    int view_info_w = 0;
-   int sorted_label_widths[MAXTABS];
    int tot_width;
    int maxsize = bh;
    int tab_starting_x = 0;
@@ -1355,9 +1529,9 @@ drawtab(Monitor *m) {
    tot_width = view_info_w;
 
    /* Calculates number of labels and their width */
+   updatevis(m);
    m->ntabs = 0;
-   for(c = m->clients; c; c = c->next){
-     if(!ISVISIBLE(c) || c->isInSkipList) continue;
+   for(i = 0; i < m->nvis[ListFocus]; i++){
      /*m->tab_widths[m->ntabs] = TEXTW(name);*/ // original
      m->tab_widths[m->ntabs] = tabWidth;
      tot_width += m->tab_widths[m->ntabs];
@@ -1368,25 +1542,15 @@ drawtab(Monitor *m) {
    // TODO: this logic is deprecated, since all the tabs will be of constant width:
    // or is it deprecated?
    if(tot_width > m->ww){ //not enough space to display the labels/tabs, they need to be truncated
-     memcpy(sorted_label_widths, m->tab_widths, sizeof(int) * m->ntabs);
-     // TODO: why is sorting needed?:
-     qsort(sorted_label_widths, m->ntabs, sizeof(int), cmpint);
-     tot_width = view_info_w; // initializes tot_width with view info, tabs will be added
-     for(i = 0; i < m->ntabs; ++i){
-       if(tot_width + (m->ntabs - i) * sorted_label_widths[i] > m->ww)
-         break;
-       tot_width += sorted_label_widths[i];
-     }
-
-     // here is the trucated tab width set ??:
-     maxsize = (m->ww - tot_width) / (m->ntabs - i);
+     // all tabs are tabWidth wide, so they shrink evenly into what the view
+     // info leaves over (this used to sort the widths to find that out)
+     maxsize = (m->ww - view_info_w) / m->ntabs;
    } else{
      maxsize = m->ww;
    }
 
-   for( i = 0, c = m->clients; c; c = c->next ) {
-     if(!ISVISIBLE(c) || c->isInSkipList) continue;
-     if(i >= m->ntabs) break;
+   for(i = 0; i < m->ntabs; i++) {
+     c = m->vis[ListFocus][i];
      if(m->tab_widths[i] >  maxsize) m->tab_widths[i] = maxsize;
 
      // TODO: here is the place to center-justify tab text:
@@ -1405,11 +1569,10 @@ drawtab(Monitor *m) {
          *col = dc.colors[ (m->tagset[m->seltags] & 1 << i) ?
          *1 : (urg & 1 << i ? 2:0) ]
          */
-     drawTabbarText(dc.tabdrawable, c->name, col, 0);
+     drawtabcached(c, col, dc.w);
      /*drawtext(dc.tabdrawable, c->name, col, 0);*/
      dc.x += dc.w;
      /*tab_starting_x += m->tab_widths[i];*/
-     i++; // may not be in loop control!
    }
 
    /* cleans interspace between window names and current viewed tag label */
@@ -1422,7 +1585,38 @@ drawtab(Monitor *m) {
    drawTabbarText(dc.tabdrawable, view_info, dc.colors[0], 0);
 
    XCopyArea(dpy, dc.tabdrawable, m->tabwin, dc.gc, 0, 0, m->ww, th, 0, 0);
-   XSync(dpy, False);
+}
+
+/* composite c's tab into the tab bar at dc.x, rendering it again only when
+ * its title, colours or width differ from the cached pixmap */
+void
+drawtabcached(Client *c, unsigned long *col, int w) {
+	int x = dc.x;
+
+	if(w <= 0)
+		return;
+	if(!c->tabpm || c->tabw != w || c->tabcol != col || c->tabhash != c->namehash) {
+		if(c->tabpm && c->tabw != w) {
+			XFreePixmap(dpy, c->tabpm);
+			c->tabpm = None;
+		}
+		if(!c->tabpm)
+			c->tabpm = XCreatePixmap(dpy, root, w, th, DefaultDepth(dpy, screen));
+		dc.x = 0;
+		dc.w = w;
+		drawTabbarText(c->tabpm, NULL, col, 0);
+		if(w > 2 * th && drawicon(c->tabpm, c, IconTab, col[ColBG], (th - iconsz[IconTab]) / 2,
+		                          (th - iconsz[IconTab]) / 2)) {
+			dc.x = th;
+			dc.w = w - th;
+		}
+		drawTabbarText(c->tabpm, c->name, col, 0);
+		dc.x = x;
+		c->tabw = w;
+		c->tabcol = col;
+		c->tabhash = c->namehash;
+	}
+	XCopyArea(dpy, c->tabpm, dc.tabdrawable, dc.gc, 0, 0, w, th, x, 0);
 }
 
 void
@@ -1455,6 +1649,7 @@ void
 drawtext(Drawable drawable, const char *text, unsigned long col[ColLast], Bool pad) {
 	char buf[256];
 	int i, x, y, h, len, olen;
+	unsigned int fit;
 
 	XSetForeground(dpy, dc.gc, col[ColBG]);
 	/*XFillRectangle(dpy, dc.drawable, dc.gc, dc.x, dc.y, dc.w, dc.h);*/
@@ -1466,7 +1661,8 @@ drawtext(Drawable drawable, const char *text, unsigned long col[ColLast], Bool p
     y = dc.y + ((dc.h + dc.font.ascent - dc.font.descent) / 2);
 	x = dc.x + (h / 2);
 	/* shorten text if necessary */
-	for(len = MIN(olen, sizeof buf); len && textnw(text, len) > dc.w - h; len--);
+	textfit(&dc.font, text, MIN(olen, sizeof buf), dc.w - h, &fit);
+	len = fit;
 	if(!len)
 		return;
 	memcpy(buf, text, len);
@@ -1545,6 +1741,7 @@ void
 drawTabbarText(Drawable drawable, const char *text, unsigned long col[ColLast], Bool pad) {
 	char buf[256];
 	int i, x, y, h, len, olen;
+	unsigned int fit;
     const short lenOfTruncationDots = 3;
     const short lenOfWhiteSpaceBufferEachSide = 2;
     const short isDefaultTabWidth = ( dc.w == tabWidth ) ? 1 : 0;
@@ -1562,7 +1759,8 @@ drawTabbarText(Drawable drawable, const char *text, unsigned long col[ColLast],
 
 	/* shorten text if necessary */
     // defines new text length (len), if len > dc.w:
-	for(len = MIN(olen, sizeof buf); len && textnw(text, len+2*lenOfWhiteSpaceBufferEachSide) > dc.w - h; len--);
+	textfit(&dc.font, text, MIN(olen, sizeof buf) + 2*lenOfWhiteSpaceBufferEachSide, dc.w - h, &fit);
+	len = MAX((int)fit - 2*lenOfWhiteSpaceBufferEachSide, 0);
 	/*if(!len)*/
 	if(len < lenOfTruncationDots)
 		return;
@@ -1650,14 +1848,19 @@ drawTabbarText_OLD(Drawable drawable, const char *text, unsigned long col[ColLas
 
 void
 enternotify(XEvent *e) {
+	Client *c;
+	Monitor *m;
+	XCrossingEvent *ev = &e->xcrossing;
+
+	if((m = winindexget(&baridx, ev->window)) && ev->window == m->crosswin) {
+		crossmon(ev, m);
+		return;
+	}
     if(!focus_follows_mouse) {
         return;
     }
-
-	Client *c, *prevClient;
-	Monitor *m;
-	XCrossingEvent *ev = &e->xcrossing;
-    prevClient = selmon->sel;
+	if(ev->serial < enterserial) /* caused by our own restacking */
+		return;
 
     // skip enternotify, if event was caused by the mouse movement generated by the transferPointerToNextMon():
     if (transfer_pointer && ev->x_root == txPointer_x && ev->y_root == txPointer_y) {
@@ -1679,16 +1882,6 @@ enternotify(XEvent *e) {
     // TODO: if we want to use ffm and mff at the same time, we need to call focus()
     // with some another param notifying that it was called by enternotif() (since
     // mff cursorwarp is handled there)
-
-    // same as in focusstack:
-    /*selmon->clt[selmon->selclt] = selmon->sel;*/
-    /*selmon->selclt ^= 1;*/
-    /*selmon->clt[selmon->selclt] = c;*/
-        if ( c != clt[selclt] ) {
-            clt[selclt] = prevClient;
-            selclt ^= 1;
-            clt[selclt] = c;
-        }
 	focus(c);
 
     // store the new mouse pos for next roll of enternotify():
@@ -1732,10 +1925,37 @@ expose(XEvent *e) {
 	Monitor *m;
 	XExposeEvent *ev = &e->xexpose;
 
-	if(ev->count == 0 && (m = wintomon(ev->window))){
-		drawbar(m);
-		drawtab(m);
+	if(ev->count == 0 && (m = wintomon(ev->window)))
+		markdirty(m, DirtyBar|DirtyTabs);
+}
+
+void
+flushbars(void) {
+	static Monitor *lastsel = NULL;
+	Monitor *m;
+	Bool tray = False;
+
+	/* the status, systray and highlights follow the selected monitor */
+	if(selmon != lastsel) {
+		for(m = mons; m; m = m->next)
+			if(m == selmon || m == lastsel)
+				m->dirty |= DirtyAll;
+		lastsel = selmon;
+	}
+	for(m = mons; m; m = m->next) {
+		if(m->dirty & DirtySystray) {
+			resizebarwin(m);
+			m->dirty |= DirtyStatus;
+			tray = True;
+		}
+		if(m->dirty & DirtyBar)
+			drawbar(m);
+		if(m->dirty & DirtyTabs)
+			drawtab(m);
+		m->dirty = 0;
 	}
+	if(tray)
+		updatesystray();
 }
 
 void
@@ -1752,6 +1972,8 @@ focus(Client *c) {
 			clearurgent(c);
 		detachstack(c);
 		attachstack(c);
+		detachclass(c);
+		attachclass(c);
 		grabbuttons(c, True);
 		if(c->isfloating)
 			XSetWindowBorder(dpy, c->win, dc.colors[14][0]);
@@ -1775,8 +1997,9 @@ focus(Client *c) {
 		XSetInputFocus(dpy, root, RevertToPointerRoot, CurrentTime);
 	selmon->sel = c;
 
-	drawbars();
-	drawtabs();
+	/* the monocle symbol counts from the head of the stack */
+	markdirty(selmon, DirtyTags|DirtyTitle|DirtyTabs
+	          | (selmon->lt[selmon->sellt]->arrange == monocle ? DirtyLtSymbol : 0));
 }
 
 void
@@ -1794,32 +2017,21 @@ focusin(XEvent *e) { /* there are some broken focus acquiring clients */
 		setfocus(selmon->sel);
 }
 
-/**
-  * Note that this assumes monitors are side-by-side only.
-  */
+/* warps the pointer to the same relative spot on selmon; monitor origins
+ * come straight from their geometry, so any arrangement works */
 void
 transferPointerToNextMon(Monitor *prevMon) {
-    Monitor *m;
-    int i, x, y, w, e; // w & e are prevMon & selmon x origins;
-    i = x = y = w = e = 0;
+    int x, y;
     float cx, cy; //coefficients
+    x = y = 0;
     getrootptr(&x, &y);
 
-    // find both monitors' x origins:
-    // TODO: store these as Monitor properties during the setup!
-    for(m = mons; m != prevMon; w+=m->mw, m = m->next);
-    for(m = mons; m != selmon; e+=m->mw, m = m->next);
-
-    x -= w; // cursor x pos in relation to the monitor;
-    cx = (float) x / prevMon->mw; // coefficient
-    cy = (float) y / prevMon->mh; // coefficient
-    /*fprintf(stderr, "w: %d, e: %d\n", w, e);*/
-    /*fprintf(stderr, "cx: %f, cy: %f\n", cx, cy);*/
-    /*fprintf(stderr, "x: %d, y: %d\n", (int)(e + selmon->mw * cx), (int)(selmon->mh * cy));*/
+    cx = (float) (x - prevMon->mx) / prevMon->mw; // coefficient
+    cy = (float) (y - prevMon->my) / prevMon->mh; // coefficient
 
     // store the new mouse pos for enternotify():
-    txPointer_x = e + selmon->mw * cx;
-    txPointer_y = selmon->mh * cy;
+    txPointer_x = selmon->mx + selmon->mw * cx;
+    txPointer_y = selmon->my + selmon->mh * cy;
 
     XWarpPointer(dpy, None, root, 0, 0, 0, 0, txPointer_x, txPointer_y);
 }
@@ -1827,7 +2039,6 @@ transferPointerToNextMon(Monitor *prevMon) {
 void
 focusmon(const Arg *arg) {
     Monitor *m, *prevMon;
-    Client *previousSel = selmon->sel;
     prevMon = selmon;
 
     if(!mons->next)
@@ -1838,76 +2049,103 @@ focusmon(const Arg *arg) {
     selmon = m;
     focus(NULL);
 
-    if ( selmon->sel && selmon->sel != clt[selclt] ) {
-        clt[selclt] = previousSel;
-        selclt ^= 1;
-        clt[selclt] = selmon->sel;
-    }
-
     if (mouse_follows_focus || !transfer_pointer) return; // no point in moving cursor, if it's already following focus;
     transferPointerToNextMon(prevMon);
 }
 
-//TODO: synergy-dwm comobo:
+/* True if pid is one of synergyservers[], going by /proc/pid/comm */
+Bool
+issynergy(pid_t pid) {
+	char path[32], comm[32];
+	FILE *f;
+	int i;
+
+	snprintf(path, sizeof path, "/proc/%d/comm", (int)pid);
+	if(!(f = fopen(path, "r")))
+		return False;
+	if(!fgets(comm, sizeof comm, f))
+		comm[0] = '\0';
+	fclose(f);
+	comm[strcspn(comm, "\n")] = '\0';
+	for(i = 0; i < LENGTH(synergyservers); i++)
+		if(!strcmp(comm, synergyservers[i]))
+			return True;
+	return False;
+}
+
+/* the pid of a running synergy server, 0 if there is none.  A server once
+ * found is kept until its pidfd turns readable, which it does when the
+ * process exits (or, on kernels without pidfds, until /proc says it is
+ * gone); not finding one is kept for a few seconds, as scanning /proc
+ * takes a few milliseconds and this runs on a key binding. */
+pid_t
+synergyserver(void) {
+	static time_t scanned = 0;
+	struct pollfd pfd;
+	DIR *d;
+	struct dirent *e;
+	pid_t pid;
+
+	if(synergypid) {
+		pfd.fd = synergyfd;
+		pfd.events = POLLIN;
+		if(synergyfd >= 0 ? poll(&pfd, 1, 0) == 0 : issynergy(synergypid))
+			return synergypid;
+		if(synergyfd >= 0)
+			close(synergyfd);
+		synergyfd = -1;
+		synergypid = 0;
+		scanned = 0;
+	}
+	if(time(NULL) - scanned < 5)
+		return 0;
+	scanned = time(NULL);
+	if(!(d = opendir("/proc")))
+		return 0;
+	while(!synergypid && (e = readdir(d)))
+		if((pid = strtol(e->d_name, NULL, 10)) > 0 && issynergy(pid))
+			synergypid = pid;
+	closedir(d);
+#ifdef SYS_pidfd_open
+	/* the pid may have been reused before the pidfd pins it, look again */
+	if(synergypid && (synergyfd = syscall(SYS_pidfd_open, synergypid, 0)) >= 0
+	&& !issynergy(synergypid)) {
+		close(synergyfd);
+		synergyfd = -1;
+		synergypid = 0;
+	}
+#endif /* SYS_pidfd_open */
+	return synergypid;
+}
+
+/* focusmon() that hands the pointer over to the synergy client next to
+ * this screen when there is no monitor left in that direction, by typing
+ * the hotkeys the server's config switches screens with */
 void
 focusmon_(const Arg *arg) {
-    Monitor *m;
-    Bool isSynergyServer; // TODO: prolly not needed, rite?
-
-    /*if (isSynergyServer = getProcessId("synergys") [>|| getProcessId("synergyc")<]) { // synergy server (+or client?) running:*/
-    if (isSynergyServer = getProcessId("synergys")) {
-        /*[>getLastOccurrenceInLog(NULL); // TODO: deleteme<]*/
-            /*sleep(30);*/
-
-        if((m = dirtomon_synergy(arg->i))) { // ie monitor was found, do not switch to synergy client;
-            unfocus(selmon->sel, True);
-            selmon = m;
-            focus(NULL);
-        } else if (arg->i > 0) {
-            fprintf(stderr, "entering syn's arg > 0 logic;");
-            /*[>// switch in right direction:<]*/
-            /*[>char *e[] = { "xdotool", "keyup", "period", "key", "control+alt+shift+F12", NULL };<]*/
-            /*[>[>char *e[] = { "xdotool", "keyup", "period", "key", [>"--clearmodifiers",<] "control+alt+shift+F12", NULL };<]<]*/
-            /*[>[>char *e[] = { "xdotool", "key", [>"--clearmodifiers",<] "control+alt+shift+F12", NULL };<]<]*/
-            /*[>[>char *e[] = { "xdotool", "keyup", "period", "key", "9", NULL };<]<]*/
-            /*[>Arg a = { .v = e }; // TODO: deleteme<]*/
-            /*[>spawn(&a);<]*/
-            system("xdotool keyup period key control+alt+shift+F12");
-
-        } else if (arg->i < 0) {
-            fprintf(stderr, "entering syn's arg < 0 logic;");
-            // switch in left direction:
-            /*[>char *i[] = { "xdotool", "keyup", "comma", "key", "control+alt+shift+F11", NULL };<]*/
-            /*[>Arg b = { .v = i }; // TODO: deleteme<]*/
-            /*[>spawn(&b);<]*/
-            system("xdotool keyup Super_L");
-            system("xdotool keyup comma");
-            /*system("xdotool keyup comma key control+alt+shift+F11");*/
-            system("xdotool key super+control+alt+shift+F11");
-
-    /*[>sendKeyEvent(XK_F11, 0, KeyPress);<]*/
-            /*[>sendKey(XK_F11, XK_Super_L );<]*/
-
-            /*[>sendKey(XK_o, 0);<]*/
-            /*[>sendKey(XK_9, XK_Super_L);<]*/
-            /*[>sendKey(XK_F11, 0);<]*/
-            /*[>sendKeyEvent(XK_F11, ControlMask|AltMask|ShiftMask, KeyPress);<]*/
-            /*[>sendKeyEvent(XK_F11, Mod4Mask, KeyPress);<]*/
-            /*[>sendKeyEvent(XK_F11, 0, KeyPress);<]*/
-
-             /*TODO: this would be way better ,but doesn't work as of now:*/
-            /*[>sendKeyEvent(XK_comma, 0, KeyRelease);<]*/
-            /*[>sendKeyEvent(XK_9, 0, KeyPress);<]*/
-        }
-    } else {
-        if(!mons->next)
-            return;
-        if((m = dirtomon(arg->i)) == selmon)
-            return;
-        unfocus(selmon->sel, True);
-        selmon = m;
-        focus(NULL);
-    }
+	static const KeySym upright[] = { XK_period };
+	static const KeySym upleft[] = { XK_Super_L, XK_comma };
+	Monitor *m;
+
+	if(synergyserver()) {
+		if((m = dirtomon_synergy(arg->i))) {
+			unfocus(selmon->sel, True);
+			selmon = m;
+			focus(NULL);
+		}
+		else if(arg->i > 0)
+			sendKey(upright, LENGTH(upright), XK_F12, ControlMask|Mod1Mask|ShiftMask);
+		else if(arg->i < 0)
+			sendKey(upleft, LENGTH(upleft), XK_F11, Mod4Mask|ControlMask|Mod1Mask|ShiftMask);
+	} else {
+		if(!mons->next)
+			return;
+		if((m = dirtomon(arg->i)) == selmon)
+			return;
+		unfocus(selmon->sel, True);
+		selmon = m;
+		focus(NULL);
+	}
 }
 /*void*/
 /*focusmon(const Arg *arg) {*/
@@ -1926,30 +2164,11 @@ focusmon_(const Arg *arg) {
 // by not calling restack() after focus().
 void
 focusstackwithoutrising(const Arg *arg) {
-	Client *c = NULL, *i;
+	Client *c;
 
 	if(!selmon->sel)
 		return;
-	if(arg->i > 0) {
-		for(c = selmon->sel->next; c && (!ISVISIBLE(c) || c->isInSkipList); c = c->next);
-		if(!c)
-			for(c = selmon->clients; c && (!ISVISIBLE(c) || c->isInSkipList); c = c->next);
-	}
-	else {
-		for(i = selmon->clients; i != selmon->sel; i = i->next)
-			if(ISVISIBLE(i) && !i->isInSkipList)
-				c = i;
-		if(!c)
-			for(; i; i = i->next)
-                if(ISVISIBLE(i) && !i->isInSkipList)
-					c = i;
-	}
-	if(c) {
-        if ( c != clt[selclt] ) {
-            // note in focusstackwihtoutrising() we only change the non-selected client:
-			clt[selclt^1] = c;
-		}
-
+	if((c = visstep(selmon, ListFocus, selmon->sel, arg->i))) {
 		focus(c);
         // do not call:
 		/*restack(selmon);*/
@@ -1958,31 +2177,11 @@ focusstackwithoutrising(const Arg *arg) {
 
 void
 focusstackfloatingonly(const Arg *arg) {
-	Client *c = NULL, *i;
+	Client *c;
 
 	if(!selmon->sel)
 		return;
-	if(arg->i > 0) {
-		for(c = selmon->sel->next; c && (!ISVISIBLE(c) || c->isInSkipList || (selmon->lt[selmon->sellt]->arrange && !c->isfloating)); c = c->next);
-		if(!c)
-			for(c = selmon->clients; c && (!ISVISIBLE(c) || c->isInSkipList || (selmon->lt[selmon->sellt]->arrange && !c->isfloating)); c = c->next);
-	}
-	else {
-		for(i = selmon->clients; i != selmon->sel; i = i->next)
-			if(ISVISIBLE(i) && !i->isInSkipList && (!selmon->lt[selmon->sellt]->arrange || i->isfloating))
-				c = i;
-		if(!c)
-			for(; i; i = i->next)
-                if(ISVISIBLE(i) && !i->isInSkipList && (!selmon->lt[selmon->sellt]->arrange || i->isfloating))
-					c = i;
-	}
-	if(c) {
-        // TODO: do we want to keep the alt-tab window logic the same as in focusstackwithoutrising()?
-        if ( c != clt[selclt] ) {
-            // note in focusstackwihtoutrising() we only change the non-selected client:
-			clt[selclt^1] = c;
-		}
-
+	if((c = visstep(selmon, selmon->lt[selmon->sellt]->arrange ? ListFocusFloat : ListFocus, selmon->sel, arg->i))) {
 		focus(c);
         // do not call:
 		/*restack(selmon);*/
@@ -1992,39 +2191,13 @@ focusstackfloatingonly(const Arg *arg) {
 // TODO: now this one is avoiding floating clients, if NOT in floating mode
 void
 focusstack(const Arg *arg) {
-	Client *c = NULL, *i;
+	Client *c;
 
 	if(!selmon->sel) {
 		return;
     }
 
-	if(arg->i > 0) {
-		for(c = selmon->sel->next; c && (!ISVISIBLE(c) || c->isInSkipList || (selmon->lt[selmon->sellt]->arrange && c->isfloating)); c = c->next);
-		if(!c)
-			for(c = selmon->clients; c && (!ISVISIBLE(c) || c->isInSkipList || (selmon->lt[selmon->sellt]->arrange && c->isfloating)); c = c->next);
-	}
-	else {
-		for(i = selmon->clients; i != selmon->sel; i = i->next)
-			if(ISVISIBLE(i) && !i->isInSkipList && (!selmon->lt[selmon->sellt]->arrange || !i->isfloating))
-				c = i;
-		if(!c)
-			for(; i; i = i->next)
-                if(ISVISIBLE(i) && !i->isInSkipList && (!selmon->lt[selmon->sellt]->arrange || !i->isfloating))
-					c = i;
-	}
-
-	if(c) {
-        // same as in enternotify:
-        /*selmon->clt[selmon->selclt] = selmon->sel;*/
-        /*selmon->selclt ^= 1;*/
-        /*selmon->clt[selmon->selclt] = c;*/
-
-        if ( c != clt[selclt] ) {
-            clt[selclt] = selmon->sel;
-            selclt ^= 1;
-            clt[selclt] = c;
-        }
-
+	if((c = visstep(selmon, selmon->lt[selmon->sellt]->arrange ? ListFocusTiled : ListFocus, selmon->sel, arg->i))) {
 		focus(c);
 		restack(selmon);
 	}
@@ -2037,11 +2210,10 @@ focuswin(const Arg* arg){
   Client* c = NULL;
 
   // TODO: not quite sure why the tab-click hack is located here to be honest...:
-  /*for(c = selmon->clients; c && (iwin || !ISVISIBLE(c)) ; c = c->next){*/ // original
-  for(c = selmon->clients; c && (iwin || (!ISVISIBLE(c) || c->isInSkipList )) ; c = c->next) {
-    if(ISVISIBLE(c) && !c->isInSkipList) --iwin;
-    /*if(ISVISIBLE(c)) --iwin;*/ // original
-  };
+  // tabs are drawn from the same list, see drawtab()
+  updatevis(selmon);
+  if(iwin >= 0 && iwin < selmon->nvis[ListFocus])
+    c = selmon->vis[ListFocus][iwin];
   if(c) {
     focus(c);
     restack(selmon);
@@ -2049,7 +2221,7 @@ focuswin(const Arg* arg){
 }
 
 Atom
-getatomprop(Client *c, Atom prop) {
+getatomprop(Window w, Atom prop) {
 	int di;
 	unsigned long dl;
 	unsigned char *p = NULL;
@@ -2060,7 +2232,7 @@ getatomprop(Client *c, Atom prop) {
    if(prop == xatom[XembedInfo])
        req = xatom[XembedInfo];
 
-   if(XGetWindowProperty(dpy, c->win, prop, 0L, sizeof atom, False, req,
+   if(XGetWindowProperty(dpy, w, prop, 0L, sizeof atom, False, req,
 			      &da, &di, &dl, &dl, &p) == Success && p) {
 		atom = *(Atom *)p;
        if(da == xatom[XembedInfo] && dl == 2)
@@ -2070,6 +2242,14 @@ getatomprop(Client *c, Atom prop) {
 	return atom;
 }
 
+/* back to the pool; the slab itself stays allocated until cleanup() */
+void
+freeclient(Client *c) {
+	free(c->name);
+	c->next = freeclients;
+	freeclients = c;
+}
+
 unsigned long
 getcolor(const char *colstr) {
 	Colormap cmap = DefaultColormap(dpy, screen);
@@ -2080,16 +2260,237 @@ getcolor(const char *colstr) {
 	return color.pixel;
 }
 
-Bool
-getrootptr(int *x, int *y) {
-	int di;
-	unsigned int dui;
-	Window dummy;
+#ifdef XCB
+enum { PropNetName, PropName, PropClass, PropTrans, PropState, PropType,
+       PropSize, PropHints, PropLast };
 
-	return XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
+/* decode a WM_CLASS value the way XGetClassHint() does */
+static void
+xcbclass(xcb_get_property_reply_t *r, WinProps *p) {
+	char *v = xcb_get_property_value(r);
+	int len = xcb_get_property_value_length(r), n;
+
+	if(!r->format || r->type != XA_STRING || len <= 0)
+		return;
+	for(n = 0; n < len && v[n]; n++);
+	snprintf(p->instance, sizeof p->instance, "%.*s", n, v);
+	if(n + 1 < len)
+		snprintf(p->class, sizeof p->class, "%.*s", len - n - 1, v + n + 1);
+	else
+		p->class[0] = '\0';
 }
 
-long
+static Bool
+xcbtext(xcb_get_property_reply_t *r, char *text, unsigned int size) {
+	XTextProperty name;
+
+	if(!r->type || !r->format || xcb_get_property_value_length(r) <= 0)
+		return False;
+	name.value = xcb_get_property_value(r);
+	name.encoding = r->type;
+	name.format = r->format;
+	name.nitems = xcb_get_property_value_length(r) / (r->format / 8);
+	textprop(&name, text, size);
+	return True;
+}
+
+/* issue every request for all windows first, then collect the replies: two
+ * round trips for the whole set instead of a dozen per window */
+void
+getprops(Window *wins, WinProps *wp, unsigned int n) {
+	static const struct { Atom type; uint32_t len; } req[PropLast] = {
+		[PropNetName] = { XCB_GET_PROPERTY_TYPE_ANY, 1024 },
+		[PropName]    = { XCB_GET_PROPERTY_TYPE_ANY, 1024 },
+		[PropClass]   = { XA_STRING, 1024 },
+		[PropTrans]   = { XA_WINDOW, 1 },
+		[PropState]   = { XA_ATOM, sizeof(Atom) },  /* as getatomprop() */
+		[PropType]    = { XA_ATOM, sizeof(Atom) },
+		[PropSize]    = { XA_WM_SIZE_HINTS, 18 },
+		[PropHints]   = { XA_WM_HINTS, 9 }
+	};
+	xcb_connection_t *xc = XGetXCBConnection(dpy);
+	xcb_get_window_attributes_cookie_t *ac;
+	xcb_get_geometry_cookie_t *gc;
+	xcb_get_property_cookie_t *sc, *pc;
+	xcb_get_window_attributes_reply_t *ar;
+	xcb_get_geometry_reply_t *gr;
+	xcb_get_property_reply_t *r;
+	Atom atoms[PropLast];
+	uint32_t *v;
+	unsigned int i, j;
+
+	atoms[PropNetName] = netatom[NetWMName];
+	atoms[PropName] = XA_WM_NAME;
+	atoms[PropClass] = XA_WM_CLASS;
+	atoms[PropTrans] = XA_WM_TRANSIENT_FOR;
+	atoms[PropState] = netatom[NetWMState];
+	atoms[PropType] = netatom[NetWMWindowType];
+	atoms[PropSize] = XA_WM_NORMAL_HINTS;
+	atoms[PropHints] = XA_WM_HINTS;
+	if(!(ac = malloc(n * (sizeof *ac + sizeof *gc + (1 + PropLast) * sizeof *sc))))
+		die("fatal: could not malloc() %u bytes\n", n * (sizeof *ac + sizeof *gc + (1 + PropLast) * sizeof *sc));
+	gc = (xcb_get_geometry_cookie_t *)(ac + n);
+	sc = (xcb_get_property_cookie_t *)(gc + n);
+	pc = sc + n;
+
+	/* attributes first, the properties are only wanted for managed windows */
+	for(i = 0; i < n; i++) {
+		ac[i] = xcb_get_window_attributes(xc, wins[i]);
+		gc[i] = xcb_get_geometry(xc, wins[i]);
+		sc[i] = xcb_get_property(xc, 0, wins[i], wmatom[WMState], wmatom[WMState], 0, 2);
+	}
+	for(i = 0; i < n; i++) {
+		memset(&wp[i], 0, sizeof wp[i]);
+		wp[i].wmstate = -1;
+		ar = xcb_get_window_attributes_reply(xc, ac[i], NULL);
+		gr = xcb_get_geometry_reply(xc, gc[i], NULL);
+		if(ar && gr) {
+			wp[i].hasattrs = True;
+			wp[i].wa.x = gr->x;
+			wp[i].wa.y = gr->y;
+			wp[i].wa.width = gr->width;
+			wp[i].wa.height = gr->height;
+			wp[i].wa.border_width = gr->border_width;
+			wp[i].wa.override_redirect = ar->override_redirect;
+			wp[i].wa.map_state = ar->map_state;
+		}
+		free(ar);
+		free(gr);
+		if((r = xcb_get_property_reply(xc, sc[i], NULL))) {
+			if(xcb_get_property_value_length(r) >= 4)
+				wp[i].wmstate = *(uint32_t *)xcb_get_property_value(r);
+			free(r);
+		}
+		if(wp[i].hasattrs && !wp[i].wa.override_redirect)
+			for(j = 0; j < PropLast; j++)
+				pc[i * PropLast + j] = xcb_get_property(xc, 0, wins[i], atoms[j],
+				                                        req[j].type, 0, req[j].len);
+	}
+	for(i = 0; i < n; i++) {
+		if(!wp[i].hasattrs || wp[i].wa.override_redirect)
+			continue;
+		strcpy(wp[i].class, broken);
+		strcpy(wp[i].instance, broken);
+		for(j = 0; j < PropLast; j++) {
+			if(!(r = xcb_get_property_reply(xc, pc[i * PropLast + j], NULL)))
+				continue;
+			v = xcb_get_property_value(r);
+			switch(j) {
+			case PropNetName:
+				xcbtext(r, wp[i].name, sizeof wp[i].name);
+				break;
+			case PropName:
+				if(!wp[i].name[0])
+					xcbtext(r, wp[i].name, sizeof wp[i].name);
+				break;
+			case PropClass:
+				xcbclass(r, &wp[i]);
+				break;
+			case PropTrans:
+				if(r->type == XA_WINDOW && r->format == 32 && r->value_len) {
+					wp[i].trans = v[0];
+					wp[i].hastrans = True;
+				}
+				break;
+			case PropState:
+			case PropType:
+				if(r->type == XA_ATOM && r->format == 32 && r->value_len)
+					*(j == PropState ? &wp[i].state : &wp[i].wtype) = v[0];
+				break;
+			case PropSize: /* as XGetWMNormalHints() */
+				if(r->type != XA_WM_SIZE_HINTS || r->format != 32 || r->value_len < 15)
+					break;
+				wp[i].hassize = True;
+				wp[i].size.flags = v[0];
+				wp[i].size.min_width = (int32_t)v[5];
+				wp[i].size.min_height = (int32_t)v[6];
+				wp[i].size.max_width = (int32_t)v[7];
+				wp[i].size.max_height = (int32_t)v[8];
+				wp[i].size.width_inc = (int32_t)v[9];
+				wp[i].size.height_inc = (int32_t)v[10];
+				wp[i].size.min_aspect.x = (int32_t)v[11];
+				wp[i].size.min_aspect.y = (int32_t)v[12];
+				wp[i].size.max_aspect.x = (int32_t)v[13];
+				wp[i].size.max_aspect.y = (int32_t)v[14];
+				if(r->value_len >= 18) {
+					wp[i].size.base_width = (int32_t)v[15];
+					wp[i].size.base_height = (int32_t)v[16];
+					wp[i].size.win_gravity = (int32_t)v[17];
+				}
+				else
+					wp[i].size.flags &= ~(PBaseSize|PWinGravity);
+				break;
+			case PropHints: /* as XGetWMHints() */
+				if(r->type != XA_WM_HINTS || r->format != 32 || r->value_len < 8)
+					break;
+				wp[i].haswmh = True;
+				wp[i].wmh.flags = v[0];
+				wp[i].wmh.input = (int32_t)v[1];
+				wp[i].wmh.initial_state = (int32_t)v[2];
+				wp[i].wmh.icon_pixmap = v[3];
+				wp[i].wmh.icon_window = v[4];
+				wp[i].wmh.icon_x = (int32_t)v[5];
+				wp[i].wmh.icon_y = (int32_t)v[6];
+				wp[i].wmh.icon_mask = v[7];
+				if(r->value_len >= 9)
+					wp[i].wmh.window_group = v[8];
+				else
+					wp[i].wmh.flags &= ~WindowGroupHint;
+				break;
+			}
+			free(r);
+		}
+	}
+	free(ac);
+}
+#else
+void
+getprops(Window *wins, WinProps *wp, unsigned int n) {
+	XClassHint ch = { NULL, NULL };
+	XWMHints *wmh;
+	long msize;
+	unsigned int i;
+
+	for(i = 0; i < n; i++) {
+		memset(&wp[i], 0, sizeof wp[i]);
+		wp[i].wmstate = getstate(wins[i]);
+		if(!(wp[i].hasattrs = XGetWindowAttributes(dpy, wins[i], &wp[i].wa))
+		|| wp[i].wa.override_redirect)
+			continue;
+		if(!gettextprop(wins[i], netatom[NetWMName], wp[i].name, sizeof wp[i].name))
+			gettextprop(wins[i], XA_WM_NAME, wp[i].name, sizeof wp[i].name);
+		XGetClassHint(dpy, wins[i], &ch);
+		snprintf(wp[i].class, sizeof wp[i].class, "%s", ch.res_class ? ch.res_class : broken);
+		snprintf(wp[i].instance, sizeof wp[i].instance, "%s", ch.res_name ? ch.res_name : broken);
+		if(ch.res_class)
+			XFree(ch.res_class);
+		if(ch.res_name)
+			XFree(ch.res_name);
+		ch.res_class = ch.res_name = NULL;
+		wp[i].hastrans = XGetTransientForHint(dpy, wins[i], &wp[i].trans);
+		wp[i].state = getatomprop(wins[i], netatom[NetWMState]);
+		wp[i].wtype = getatomprop(wins[i], netatom[NetWMWindowType]);
+		wp[i].hassize = XGetWMNormalHints(dpy, wins[i], &wp[i].size, &msize);
+		if((wmh = XGetWMHints(dpy, wins[i]))) {
+			wp[i].wmh = *wmh;
+			wp[i].haswmh = True;
+			XFree(wmh);
+		}
+	}
+}
+#endif /* XCB */
+
+Bool
+getrootptr(int *x, int *y) {
+	int di;
+	unsigned int dui;
+	Window dummy;
+
+	return XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
+}
+
+#ifndef XCB
+long
 getstate(Window w) {
 	int format;
 	long result = -1;
@@ -2105,6 +2506,34 @@ getstate(Window w) {
 	XFree(p);
 	return result;
 }
+#endif /* XCB */
+
+#ifdef XSYNC
+/* the counter c bumps once it has drawn a size, None unless it takes
+ * part in _NET_WM_SYNC_REQUEST */
+XSyncCounter
+getsynccounter(Client *c) {
+	int di, n;
+	unsigned long dl, len;
+	unsigned char *p = NULL;
+	Atom da, *protocols;
+	Bool exists = False;
+	XSyncCounter counter = None;
+
+	if(!XGetWMProtocols(dpy, c->win, &protocols, &n))
+		return None;
+	while(!exists && n--)
+		exists = protocols[n] == wmatom[WMSyncRequest];
+	XFree(protocols);
+	if(exists && XGetWindowProperty(dpy, c->win, wmatom[WMSyncCounter], 0L, 1L, False,
+	                                XA_CARDINAL, &da, &di, &len, &dl, &p) == Success && p) {
+		if(len)
+			counter = *(unsigned long *)p;
+		XFree(p);
+	}
+	return counter;
+}
+#endif /* XSYNC */
 
 unsigned int
 getsystraywidth() {
@@ -2117,8 +2546,6 @@ getsystraywidth() {
 
 Bool
 gettextprop(Window w, Atom atom, char *text, unsigned int size) {
-	char **list = NULL;
-	int n;
 	XTextProperty name;
 
 	if(!text || size == 0)
@@ -2127,15 +2554,7 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size) {
 	XGetTextProperty(dpy, w, &name, atom);
 	if(!name.nitems)
 		return False;
-	if(name.encoding == XA_STRING)
-		strncpy(text, (char *)name.value, size - 1);
-	else {
-		if(XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
-			strncpy(text, *list, size - 1);
-			XFreeStringList(list);
-		}
-	}
-	text[size - 1] = '\0';
+	textprop(&name, text, size);
 	XFree(name.value);
 	return True;
 }
@@ -2269,6 +2688,7 @@ initfont2(const char *fontstr, DC *dc) {
 		dc->font.descent = dc->font.xfont->descent;
 	}
 	dc->font.height = dc->font.ascent + dc->font.descent;
+	memset(dc->font.glyphs, 0, sizeof dc->font.glyphs);
 }
 
 #ifdef XINERAMA
@@ -2304,23 +2724,56 @@ isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info) {
 	/*}*/
 /*}*/
 
-void
-keyrelease(XEvent *e) {
-	unsigned int i;
-	KeySym keysym;
-	XKeyEvent *ev;
-
-    fprintf(stderr, "     @keyrelease: in beginning.\n");
-
-	ev = &e->xkey;
-    keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
-	/*keysym = XK_Tab;*/
-
-    if(keysym == XK_Tab
-            && CLEANMASK(AltMask) == CLEANMASK(ev->state) ) {
-        fprintf(stderr, "     @keyrelease: altTab release detected \n");
-    }
-
+static void
+interngrow(InternTable *t) {
+	InternEntry *old = t->tab;
+	unsigned int i, j, oldsize = t->size;
+
+	t->size = oldsize ? oldsize * 2 : 64;
+	if(!(t->tab = calloc(t->size, sizeof(InternEntry))))
+		die("fatal: could not malloc() %u bytes\n", t->size * sizeof(InternEntry));
+	for(i = 0; i < oldsize; i++) {
+		if(!old[i].str)
+			continue;
+		for(j = old[i].hash & (t->size - 1); t->tab[j].str; j = (j + 1) & (t->size - 1));
+		t->tab[j] = old[i];
+	}
+	free(old);
+}
+
+/* the shared copy of class string s; the returned entry may move on the
+ * next call, its str never does and lives until cleanup() */
+const InternEntry *
+intern(const char *s) {
+	unsigned int i, h = strhash(s);
+	size_t len;
+
+	if((classes.count + 1) * 4 > classes.size * 3)
+		interngrow(&classes);
+	for(i = h & (classes.size - 1); classes.tab[i].str; i = (i + 1) & (classes.size - 1))
+		if(classes.tab[i].hash == h && !strcmp(classes.tab[i].str, s))
+			return &classes.tab[i];
+	len = strlen(s) + 1;
+	if(!(classes.tab[i].str = malloc(len)))
+		die("fatal: could not malloc() %u bytes\n", len);
+	memcpy(classes.tab[i].str, s, len);
+	classes.tab[i].hash = h;
+	classes.tab[i].flags = classflags(s);
+	classes.count++;
+	return &classes.tab[i];
+}
+
+/* the entry of an interned string, NULL if s was never interned */
+InternEntry *
+internlookup(const char *s) {
+	unsigned int i, h;
+
+	if(!classes.size)
+		return NULL;
+	for(h = strhash(s), i = h & (classes.size - 1); classes.tab[i].str; i = (i + 1) & (classes.size - 1))
+		if(classes.tab[i].str == s || (classes.tab[i].hash == h && !strcmp(classes.tab[i].str, s)))
+			return &classes.tab[i];
+	return NULL;
 }
 
 void
@@ -2355,6 +2808,62 @@ keypress(XEvent *e) {
     /*}*/
 }
 
+/* apply the monitor part of a _DWM_STATE left by reload(); client records
+ * are kept in snapidx for manage() until scan() is done */
+void
+loadstate(void) {
+	int di;
+	unsigned long i, j, n, dl, numtags = LENGTH(tags) + 1;
+	unsigned char *data = NULL;
+	long *p;
+	Atom da;
+	Monitor *m;
+
+	if(XGetWindowProperty(dpy, root, wmatom[WMDwmState], 0L, LONG_MAX / 4, True,
+	                      XA_CARDINAL, &da, &di, &n, &dl, &data) != Success || !data)
+		return;
+	p = (long *)data;
+	/* a snapshot from a build with another number of tags is of no use */
+	if(n < STATEHDR || p[0] != STATEMAGIC || p[1] != numtags
+	|| n != STATEHDR + p[2] * STATEMON(numtags) + p[3] * STATECLIENT) {
+		XFree(data);
+		return;
+	}
+	snapshot = p;
+	for(m = mons; m && m->num != p[4]; m = m->next);
+	if(m)
+		selmon = m;
+	for(i = 0, p += STATEHDR; i < snapshot[2]; i++, p += STATEMON(numtags)) {
+		for(m = mons; m && m->num != p[0]; m = m->next);
+		if(!m)
+			continue;
+		m->seltags = p[1] & 1;
+		m->sellt = p[2] & 1;
+		m->tagset[0] = p[3];
+		m->tagset[1] = p[4];
+		if(p[5] >= 0 && p[5] < numtags)
+			m->curtag = p[5];
+		if(p[6] >= 0 && p[6] < numtags)
+			m->prevtag = p[6];
+		m->showbar = p[7];
+		m->showtab = p[8];
+		if(p[9] >= 0 && p[9] < LENGTH(layouts))
+			m->lt[0] = &layouts[p[9]];
+		if(p[10] >= 0 && p[10] < LENGTH(layouts))
+			m->lt[1] = &layouts[p[10]];
+		for(j = 0; j < numtags; j++) {
+			if(p[12 + j] >= 0 && p[12 + j] < LENGTH(layouts))
+				m->lts[j] = &layouts[p[12 + j]];
+			m->mfacts[j] = p[12 + numtags + j] / STATEFIXED;
+			m->nmasters[j] = p[12 + 2 * numtags + j];
+		}
+		strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
+		updatebarpos(m);
+	}
+	for(i = 0; i < snapshot[3]; i++, p += STATECLIENT)
+		winindexput(&snapidx, p[0], p);
+}
+
 void
 killclient(const Arg *arg) {
 	if(!selmon->sel)
@@ -2364,34 +2873,53 @@ killclient(const Arg *arg) {
 		XSetErrorHandler(xerrordummy);
 		XSetCloseDownMode(dpy, DestroyAll);
 		XKillClient(dpy, selmon->sel->win);
-		XSync(dpy, False);
+		xsync();
 		XSetErrorHandler(xerror);
 		XUngrabServer(dpy);
 	}
 }
 
 void
-manage(Window w, XWindowAttributes *wa) {
+manage(Window w, WinProps *wp) {
 	Client *c, *t = NULL;
 	Window trans = None;
+	XWindowAttributes *wa = &wp->wa;
 	XWindowChanges wc;
+	Monitor *m;
+	long *rec = snapshot ? winindexget(&snapidx, w) : NULL;
+	const InternEntry *ie;
 
-	if(!(c = calloc(1, sizeof(Client))))
-		die("fatal: could not malloc() %u bytes\n", sizeof(Client));
+	c = newclient();
 	c->win = w;
-	updatetitle(c);
-    updateClassName(c);
-
-    // TODO: mystuff:
-    c->isInSkipList = isWindowInSkipList(c);
-
-	if(XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+	/* as updatetitle(); className is the first WM_CLASS string, the instance */
+	setname(c, wp->name[0] ? wp->name : broken);
+	ie = intern(wp->instance[0] ? wp->instance : broken);
+	c->className = ie->str;
+	c->classflags = ie->flags;
+	c->resClass = intern(wp->class[0] ? wp->class : broken)->str;
+	attachclass(c);
+
+	if(wp->hastrans)
+		trans = wp->trans;
+	if(wp->hastrans && (t = wintoclient(trans))) {
 		c->mon = t->mon;
 		c->tags = t->tags;
 	}
 	else {
 		c->mon = selmon;
-		applyrules(c);
+		applyrules(c, wp->class, wp->instance);
+	}
+	if(rec) { /* restored, see savestate() */
+		for(m = mons; m && m->num != rec[1]; m = m->next);
+		if(m)
+			c->mon = m;
+		c->tags = rec[2];
+		c->isfloating = rec[3];
+		c->iscentred = False;
+		wa->x = rec[9];
+		wa->y = rec[10];
+		wa->width = rec[11];
+		wa->height = rec[12];
 	}
 	/* geometry */
 	if((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) && c->iscentred) {
@@ -2425,17 +2953,27 @@ manage(Window w, XWindowAttributes *wa) {
 	}
 	else
 		c->tags &= TAGMASK;
-	wc.border_width = c->bw;
+	wc.border_width = c->cbw = c->bw;
 	XConfigureWindow(dpy, w, CWBorderWidth, &wc);
     XSetWindowBorder(dpy, w, dc.colors[0][ColBorder]);
 	configure(c); /* propagates border_width, if size doesn't change */
-	updatewindowtype(c);
-	updatesizehints(c);
-	updatewmhints(c);
+	setwindowtype(c, wp->state, wp->wtype);
+	if(!wp->hassize)
+		wp->size.flags = PSize;
+	setsizehints(c, &wp->size);
+	if(wp->haswmh)
+		setwmhints(c, &wp->wmh);
 	c->sfx = c->x;
 	c->sfy = c->y;
 	c->sfw = c->w;
 	c->sfh = c->h;
+	if(rec) {
+		c->cfact = rec[4] / STATEFIXED;
+		c->sfx = rec[5];
+		c->sfy = rec[6];
+		c->sfw = rec[7];
+		c->sfh = rec[8];
+	}
 	XSelectInput(dpy, w, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
 	grabbuttons(c, False);
 	if(!c->isfloating)
@@ -2446,18 +2984,24 @@ manage(Window w, XWindowAttributes *wa) {
     }
 	attachaside(c);
 	attachstack(c);
+	winindexput(&clientidx, c->win, c);
 	XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h); /* some windows require this */
+	c->hidden = True;
 	setclientstate(c, NormalState);
-    if(!c->isInSkipList) {
+    if(!(c->classflags & ClassSkip)) {
         if (c->mon == selmon)
             unfocus(selmon->sel, False);
         c->mon->sel = c;
     }
 
+	if(scanning) { /* scan() arranges once when done */
+		XMapWindow(dpy, c->win);
+		return;
+	}
     arrange(c->mon);
 	XMapWindow(dpy, c->win);
 
-    if(!c->isInSkipList) {
+    if(!(c->classflags & ClassSkip)) {
         // TODO: focus, if the new window is floating
         if(c->isfloating) {
             focus(c);
@@ -2476,61 +3020,53 @@ mappingnotify(XEvent *e) {
 		grabkeys();
 }
 
+void
+markdirty(Monitor *m, unsigned int regions) {
+	if(m)
+		m->dirty |= regions;
+	else
+		for(m = mons; m; m = m->next)
+			m->dirty |= regions;
+}
+
 void
 maprequest(XEvent *e) {
-	static XWindowAttributes wa;
+	static WinProps wp;
 	XMapRequestEvent *ev = &e->xmaprequest;
    Client *i;
    if((i = wintosystrayicon(ev->window))) {
        sendevent(i->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_WINDOW_ACTIVATE, 0, systray->win, XEMBED_EMBEDDED_VERSION);
-       resizebarwin(selmon);
-       updatesystray();
+       markdirty(selmon, DirtySystray);
    }
 
-	if(!XGetWindowAttributes(dpy, ev->window, &wa))
+	if(wintoclient(ev->window))
 		return;
-	if(wa.override_redirect)
+	getprops(&ev->window, &wp, 1);
+	if(!wp.hasattrs || wp.wa.override_redirect)
 		return;
-	if(!wintoclient(ev->window))
-		manage(ev->window, &wa);
-}
-
-void
-monocle(Monitor *m) {
-  unsigned int n = 0, r = 0;
-	Client *c;
-
-  for(c = nexttiled(m->clients); c; c = nexttiled(c->next)) {
-    /* remove border when in monocle layout */
-    if(c->bw) {
-      c->oldbw = c->bw;
-      c->bw = 0;
-      r = 1;
-    }
-    resize(c, m->wx, m->wy, m->ww - (2 * c->bw), m->wh - (2 * c->bw), False);
-    if(r)
-      resizeclient(c, m->wx, m->wy, m->ww - (2 * c->bw), m->wh - (2 * c->bw));
-  }
+	manage(ev->window, &wp);
 }
 
+/* hands every client of from over to to in one splice of each list */
 void
-motionnotify(XEvent *e) {
-	static Monitor *mon = NULL;
-	Monitor *m;
-	XMotionEvent *ev = &e->xmotion;
+moveclients(Monitor *from, Monitor *to) {
+	Client *c, **tc;
 
-	if(ev->window != root)
+	if(!from->clients)
 		return;
-	if((m = recttomon(ev->x_root, ev->y_root, 1, 1)) != mon && mon) {
-		selmon = m;
-		focus(NULL);
-	}
-	mon = m;
+	for(c = from->clients; c; c = c->next)
+		c->mon = to;
+	for(tc = &to->clients; *tc; tc = &(*tc)->next);
+	*tc = from->clients;
+	for(tc = &to->stack; *tc; tc = &(*tc)->snext);
+	*tc = from->stack;
+	from->clients = from->stack = from->sel = NULL;
+	from->visdirty = to->visdirty = True;
 }
 
 void
 movemouse(const Arg *arg) {
-	int x, y, ocx, ocy, nx, ny;
+	int x, y, ocx, ocy, nx, ny, tx, ty, d;
 	Client *c;
 	Monitor *m;
 	XEvent ev;
@@ -2545,6 +3081,7 @@ movemouse(const Arg *arg) {
 		return;
 	if(!getrootptr(&x, &y))
 		return;
+	buildedges(c);
 	do {
 		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
 		switch(ev.type) {
@@ -2552,66 +3089,37 @@ movemouse(const Arg *arg) {
 		case Expose:
 		case MapRequest:
 			handler[ev.type](&ev);
+			flushbars();
+			if(ev.type != Expose)
+				buildedges(c);
 			break;
 		case MotionNotify:
+			/* only the newest position matters */
+			while(XCheckTypedEvent(dpy, MotionNotify, &ev));
 			nx = ocx + (ev.xmotion.x - x);
 			ny = ocy + (ev.xmotion.y - y);
 
             // TODO: snap also along the axis? (when initial snapping has already
             // occurred);
-            // TODO: refactor!
-
-            // win2win snapping:
-            for( Client *cc = c->mon->clients; cc; cc = cc->next ) {
-                if ( cc == c || !ISVISIBLE(cc) ) continue;
-
-                // snap x axis:
-                if ( ( ( c->y-c->bw >= cc->y-c->bw && c->y-c->bw <= cc->y+c->bw + cc->h )
-                        || ( c->y+c->h+c->bw <= cc->y+c->bw+cc->h && c->y+c->h+c->bw >= cc->y-c->bw ) ) // one corner is inside other client (cc)
-                    || ( ( cc->y >= c->y && cc->y <= c->y + c->h )
-                        || ( cc->y+cc->h <= c->y+c->h && cc->y+cc->h >= c->y )) ) { // ie there's contact along y-axis;
-                    // snap to other client right side:
-                    if( abs( cc->x+cc->w - nx ) < snap )
-                        /*nx = cc->x + cc->w;*/
-                        nx = cc->x + cc->w + 2*c->bw;
-                    // snap to other client left side:
-                    else if( abs( nx + c->w - cc->x ) < snap )
-                        /*nx = cc->x - c->w;*/
-                        nx = cc->x - c->w - 2*c->bw;
-                }
-                // snap y axis:
-                if ( ( ( c->x-c->bw >= cc->x-c->bw && c->x-c->bw <= cc->x+cc->w+c->bw )
-                        || ( c->x+c->w+c->bw <= cc->x+cc->w+c->bw && c->x+c->w+c->bw >= cc->x-c->bw ) ) // one corner is inside other client (cc)
-                    || ( ( cc->x >= c->x && cc->x <= c->x+c->w )
-                        || ( cc->x+cc->w <= c->x+c->w && cc->x+cc->w >= c->x )) ) {  // ie there's contact along x-axis;
-                    // snap to other client bottom:
-                    if( abs( cc->y+cc->h - ny ) < snap )
-                        ny = cc->y + cc->h + 2*c->bw;
-                    // snap to other client top:
-                    else if( abs( ny + c->h - cc->y ) < snap )
-                        ny = cc->y - c->h - 2*c->bw;
-                }
-            }
-
-            // win2screen snapping:
-			if(nx >= selmon->wx && nx <= selmon->wx + selmon->ww
-                    && ny >= selmon->wy && ny <= selmon->wy + selmon->wh) {
-
-				if(abs(selmon->wx - nx) < snap)
-					nx = selmon->wx;
-				else if(abs((selmon->wx + selmon->ww) - (nx + WIDTH(c))) < snap)
-					nx = selmon->wx + selmon->ww - WIDTH(c);
 
-                // snap y axis:
-				if(abs(selmon->wy - ny) < snap)
-					ny = selmon->wy;
-				else if(abs((selmon->wy + selmon->wh) - (ny + HEIGHT(c))) < snap)
-					ny = selmon->wy + selmon->wh - HEIGHT(c);
-
-				if(!c->isfloating && selmon->lt[selmon->sellt]->arrange
-                        && (abs(nx - c->x) > snap || abs(ny - c->y) > snap))
-					togglefloating(NULL);
+            // snap x to the nearest edge in contact along the y axis, then y:
+            d = snap;
+            tx = nx;
+            snapedge(EdgeLeft, nx, c->y, c->y + HEIGHT(c), &tx, &d);
+            snapedge(EdgeRight, nx + c->w, c->y, c->y + HEIGHT(c), &tx, &d);
+            d = snap;
+            ty = ny;
+            snapedge(EdgeTop, ny, c->x, c->x + WIDTH(c), &ty, &d);
+            snapedge(EdgeBottom, ny + c->h, c->x, c->x + WIDTH(c), &ty, &d);
+            nx = tx;
+            ny = ty;
 
+			if(nx >= selmon->wx && nx <= selmon->wx + selmon->ww
+                    && ny >= selmon->wy && ny <= selmon->wy + selmon->wh
+                    && !c->isfloating && selmon->lt[selmon->sellt]->arrange
+                    && (abs(nx - c->x) > snap || abs(ny - c->y) > snap)) {
+				togglefloating(NULL);
+				buildedges(c); /* the others were rearranged */
 			}
 			if(!selmon->lt[selmon->sellt]->arrange || c->isfloating)
 				resize(c, nx, ny, c->w, c->h, True);
@@ -2626,12 +3134,65 @@ movemouse(const Arg *arg) {
 	}
 }
 
+/* a zeroed Client from the pool, which grows by one slab when empty */
+Client *
+newclient(void) {
+	ClientSlab *s;
+	Client *c;
+	int i;
+
+	if(!freeclients) {
+		if(!(s = malloc(sizeof(ClientSlab))))
+			die("fatal: could not malloc() %u bytes\n", sizeof(ClientSlab));
+		s->next = slabs;
+		slabs = s;
+		for(i = CLIENTSLAB - 1; i >= 0; i--) {
+			s->c[i].next = freeclients;
+			freeclients = &s->c[i];
+		}
+	}
+	c = freeclients;
+	freeclients = c->next;
+	memset(c, 0, sizeof(Client));
+	return c;
+}
+
 Client *
 nexttiled(Client *c) {
 	for(; c && (c->isfloating || !ISVISIBLE(c)); c = c->next);
 	return c;
 }
 
+#ifdef XRANDR
+/* m lost its output: its clients move to to, remembering m as their home,
+ * and m keeps its tags and layouts in parked until unparkclients() */
+void
+parkmon(Monitor *m, Monitor *to) {
+	Client *c;
+
+	for(c = m->clients; c; c = c->next)
+		if(!c->home)
+			c->home = m;
+	if(m->clients)
+		to->resized = True;
+	moveclients(m, to);
+	if(m->barwin) {
+		winindexdel(&baridx, m->barwin);
+		winindexdel(&baridx, m->tabwin);
+		winindexdel(&baridx, m->crosswin);
+		XDestroyWindow(dpy, m->barwin);
+		XDestroyWindow(dpy, m->tabwin);
+		XDestroyWindow(dpy, m->cellwin);
+		XDestroyWindow(dpy, m->crosswin);
+		m->barwin = m->tabwin = m->cellwin = m->crosswin = 0;
+	}
+	if(m == selmon)
+		selmon = to;
+	m->next = parked;
+	parked = m;
+}
+#endif /* XRANDR */
+
 void
 pop(Client *c) {
 	detach(c);
@@ -2657,8 +3218,7 @@ propertynotify(XEvent *e) {
        }
        else
            updatesystrayiconstate(c, ev);
-       resizebarwin(selmon);
-       updatesystray();
+       markdirty(selmon, DirtySystray);
    }
 
 	if((ev->window == root) && (ev->atom == XA_WM_NAME))
@@ -2671,7 +3231,7 @@ propertynotify(XEvent *e) {
 		case XA_WM_TRANSIENT_FOR:
 
             // TODO: this mofo is the IDEA auto-floating culprit!
-            if ( strstr( c->className, client_class_idea ) ) return;
+            if (c->classflags & ClassIdea) return;
 
 			if(!c->isfloating && (XGetTransientForHint(dpy, c->win, &trans)) &&
 			   (c->isfloating = (wintoclient(trans)) != NULL))
@@ -2682,29 +3242,24 @@ propertynotify(XEvent *e) {
 			break;
 		case XA_WM_HINTS:
 			updatewmhints(c);
-			drawbars();
-			drawtabs();
+			markdirty(c->mon, DirtyTags|DirtyTabs);
 			break;
         // TODO: added atom to raise floating windows in relation to each other
 		case 379:
-            if ( c != clt[selclt] ) {
-                clt[selclt] = selmon->sel;
-                selclt ^= 1;
-                clt[selclt] = c;
-            }
 			raise_floating_client(c);
 			break;
 		}
 		if(ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
 			updatetitle(c);
-            // just in case, re-validate isInSkipList:
-            c->isInSkipList = isWindowInSkipList(c);
-			if(c == c->mon->sel)
-				drawbar(c->mon);
-			drawtab(c->mon);
+			markdirty(c->mon, c == c->mon->sel ? DirtyTitle|DirtyTabs : DirtyTabs);
 		}
 		if(ev->atom == netatom[NetWMWindowType])
 			updatewindowtype(c);
+		if(ev->atom == netatom[NetWMIcon]) {
+			c->iconvalid = False;
+			c->tabcol = NULL; /* render the tab again */
+			markdirty(c->mon, c == c->mon->sel ? DirtyTitle|DirtyTabs : DirtyTabs);
+		}
 	}
 }
 
@@ -2735,13 +3290,8 @@ removesystrayicon(Client *i) {
    for(ii = &systray->icons; *ii && *ii != i; ii = &(*ii)->next);
    if(ii)
        *ii = i->next;
-   free(i);
-}
-
-void
-resize(Client *c, int x, int y, int w, int h, Bool interact) {
-	if(applysizehints(c, &x, &y, &w, &h, interact))
-		resizeclient(c, x, y, w, h);
+   winindexdel(&trayidx, i->win);
+   freeclient(i);
 }
 
 resizebarwin(Monitor *m) {
@@ -2751,20 +3301,6 @@ resizebarwin(Monitor *m) {
    XMoveResizeWindow(dpy, m->barwin, m->wx, m->by, w, bh);
 }
 
-void
-resizeclient(Client *c, int x, int y, int w, int h) {
-	XWindowChanges wc;
-
-	c->oldx = c->x; c->x = wc.x = x;
-	c->oldy = c->y; c->y = wc.y = y;
-	c->oldw = c->w; c->w = wc.width = w;
-	c->oldh = c->h; c->h = wc.height = h;
-	wc.border_width = c->bw;
-	XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
-	configure(c);
-	XSync(dpy, False);
-}
-
 Bool
 isInRect( int wx, int wy, int ww, int wh, int px, int py ) {
     if( px >= wx && px <= wx + ww
@@ -2925,15 +3461,60 @@ isInTriangle( int x1, int y1, int x2, int y2, int x3, int y3, int x, int y ) {
    return (A == A1 + A2 + A3);
 }
 
+/* what resizemouse() reads off the queue; everything else waits */
+Bool
+resizeevent(Display *d, XEvent *ev, XPointer arg) {
+	switch(ev->type) {
+	case ButtonPress:
+	case ButtonRelease:
+	case MotionNotify:
+	case Expose:
+	case CirculateRequest:
+	case ConfigureRequest:
+	case MapRequest:
+		return True;
+	}
+#ifdef XSYNC
+	return hassync && ev->type == syncevbase + XSyncAlarmNotify;
+#else
+	return False;
+#endif /* XSYNC */
+}
+
+/* milliseconds on the monotonic clock, for waits that poll() resumes */
+long
+mstime(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/* Resizes are paced: queued motion collapses into the newest one, at most
+ * refreshrate sizes a second are sent, and a client speaking
+ * _NET_WM_SYNC_REQUEST gets the next size only once it has drawn the last
+ * one (or SYNCWAIT ms have passed).  The size pending when the button is
+ * released is always sent. */
 void
 resizemouse(const Arg *arg) {
 	int ocx, ocy, och, ocw; // olds/originals
-	int ph, pw; // previous client dimesions; reset after every while loop cycle; used to detect clients that allow specific min/max dimensions;
+	int ph, pw; // dimensions before the last resize sent; used to detect clients that allow specific min/max dimensions;
 	int nx, ny, nw, nh; // new
 	Client *c;
 	Monitor *m;
     int sector; // represents the part of window pointer was in at the initilaization;
 	XEvent ev;
+	Bool pending = False, waiting = False;
+	Time now = 0, last = 0, sent = 0;
+	long lastms = 0;                     /* last, on our clock */
+	struct pollfd pfd;
+#ifdef XSYNC
+	XSyncCounter counter = None;
+	XSyncAlarm alarm = None;
+	XSyncAlarmAttributes aa;
+	XSyncValue one;
+	Bool overflow;
+#endif /* XSYNC */
 
 	if(!(c = selmon->sel))
 		return;
@@ -2951,15 +3532,42 @@ resizemouse(const Arg *arg) {
     }
 
     initializeCursorResizePosition( c, sector );
+#ifdef XSYNC
+	if(hassync && (counter = getsynccounter(c))) {
+		aa.trigger.counter = counter;
+		aa.trigger.value_type = XSyncAbsolute;
+		aa.trigger.test_type = XSyncPositiveComparison;
+		XSyncQueryCounter(dpy, counter, &aa.trigger.wait_value);
+		XSyncIntToValue(&aa.delta, 0);
+		aa.events = True;
+		alarm = XSyncCreateAlarm(dpy, XSyncCACounter|XSyncCAValueType|XSyncCATestType
+		                         |XSyncCAValue|XSyncCADelta|XSyncCAEvents, &aa);
+		XSyncIntToValue(&one, 1);
+	}
+#endif /* XSYNC */
+	pfd.fd = ConnectionNumber(dpy);
+	pfd.events = POLLIN;
 	do {
-		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+		if(!pending)
+			XIfEvent(dpy, &ev, resizeevent, NULL);
+		else if(!XCheckIfEvent(dpy, &ev, resizeevent, NULL)) {
+			/* nothing newer queued: wait out the frame, or the client,
+			 * counting from the last size sent so that other events
+			 * cannot keep putting the pending one off */
+			ev.type = 0;
+			if(poll(&pfd, 1, MAX(0, lastms + (waiting ? SYNCWAIT : 1000 / refreshrate) - mstime())) > 0)
+				continue;
+		}
 		switch(ev.type) {
             case ConfigureRequest:
             case Expose:
             case MapRequest:
                 handler[ev.type](&ev);
+                flushbars();
                 break;
             case MotionNotify:
+                while(XCheckTypedEvent(dpy, MotionNotify, &ev));
+                now = ev.xmotion.time;
                 // calculate new origin & dimesions:
                 switch (sector) {
                     case UpCorRight:
@@ -3026,19 +3634,49 @@ resizemouse(const Arg *arg) {
                         togglefloating(NULL);
                 }
 
-                //store previous dimensions:
-                ph = c->h;
-                pw = c->w;
-                if(!selmon->lt[selmon->sellt]->arrange || c->isfloating)
-                    resize(c, nx, ny, nw, nh, True);
-
+                pending = !selmon->lt[selmon->sellt]->arrange || c->isfloating;
+                break;
+#ifdef XSYNC
+            default:
+                if(ev.type == syncevbase + XSyncAlarmNotify
+                        && ((XSyncAlarmNotifyEvent *)&ev)->alarm == alarm)
+                    waiting = False;
                 break;
+#endif /* XSYNC */
+		}
+		if(pending && (!ev.type || ev.type == ButtonRelease
+		               || (waiting ? now - sent >= SYNCWAIT : now - last >= 1000 / refreshrate))) {
+			//store previous dimensions:
+			ph = c->h;
+			pw = c->w;
+			/* as resize(), with the sync request ahead of the configure */
+			if(applysizehints(c, &nx, &ny, &nw, &nh, True)) {
+#ifdef XSYNC
+				if(alarm && (nw != c->w || nh != c->h)) {
+					XSyncValueAdd(&aa.trigger.wait_value, aa.trigger.wait_value, one, &overflow);
+					sendevent(c->win, wmatom[WMProtocols], NoEventMask, wmatom[WMSyncRequest], CurrentTime,
+					          XSyncValueLow32(aa.trigger.wait_value), XSyncValueHigh32(aa.trigger.wait_value), 0);
+					XSyncChangeAlarm(dpy, alarm, XSyncCAValue, &aa);
+					waiting = True;
+					sent = now;
+				}
+#endif /* XSYNC */
+				resizeclient(c, nx, ny, nw, nh);
+			}
+			XFlush(dpy);
+			pending = False;
+			last = now;
+			lastms = mstime();
 		}
 	} while(ev.type != ButtonRelease);
+#ifdef XSYNC
+	if(alarm)
+		XSyncDestroyAlarm(dpy, alarm);
+#endif /* XSYNC */
 
     initializeCursorResizePosition( c, sector );
 	XUngrabPointer(dpy, CurrentTime);
-	while(XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	skipenter();
 	if((m = recttomon(c->x, c->y, c->w, c->h)) != selmon) {
 		sendmon(c, m);
 		selmon = m;
@@ -3053,19 +3691,16 @@ resizerequest(XEvent *e) {
 
    if((i = wintosystrayicon(ev->window))) {
        updatesystrayicongeom(i, ev->width, ev->height);
-       resizebarwin(selmon);
-       updatesystray();
+       markdirty(selmon, DirtySystray);
    }
 }
 
 void
 restack(Monitor *m) {
 	Client *c;
-	XEvent ev;
 	XWindowChanges wc;
 
-	drawbar(m);
-	drawtab(m);
+	markdirty(m, DirtyTags|DirtyLtSymbol|DirtyTitle|DirtyTabs);
 	if(!m->sel)
 		return;
 	if(m->sel->isfloating || !m->lt[m->sellt]->arrange)
@@ -3080,75 +3715,375 @@ restack(Monitor *m) {
 			}
         }
     }
-	XSync(dpy, False);
-	while(XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	skipenter();
+}
+
+/* the window an event is about, which for requests and substructure
+ * notifies is not the one in xany */
+static Window
+evwindow(XEvent *ev) {
+	switch(ev->type) {
+	case ConfigureRequest: return ev->xconfigurerequest.window;
+	case ConfigureNotify:  return ev->xconfigure.window;
+	case MapRequest:       return ev->xmaprequest.window;
+	case MapNotify:        return ev->xmap.window;
+	case UnmapNotify:      return ev->xunmap.window;
+	case DestroyNotify:    return ev->xdestroywindow.window;
+	case ReparentNotify:   return ev->xreparent.window;
+	default:               return ev->xany.window;
+	}
+}
+
+/* drop an earlier queued event which q[n-1] makes redundant; events which
+ * change the lifetime or mapping of a window are never reordered across */
+void
+coalesce(XEvent *q, int n) {
+	XEvent *ev = &q[n - 1], *o;
+	Window w = evwindow(ev);
+	int i;
+
+	switch(ev->type) {
+	case Expose:
+		if(ev->xexpose.count != 0)
+			return;
+		break;
+	case MotionNotify:
+	case ConfigureNotify:
+	case ConfigureRequest:
+	case PropertyNotify:
+		break;
+	default:
+		return;
+	}
+	for(i = n - 2; i >= 0; i--) {
+		o = &q[i];
+		if(o->type == 0 || evwindow(o) != w)
+			continue;
+		switch(o->type) {
+		case MapRequest: case MapNotify: case UnmapNotify:
+		case DestroyNotify: case ReparentNotify:
+			return;
+		}
+		if(o->type != ev->type)
+			continue;
+		switch(ev->type) {
+		case Expose:
+			if(o->xexpose.count != 0)
+				continue;
+			break;
+		case PropertyNotify:
+			if(o->xproperty.atom != ev->xproperty.atom
+			|| o->xproperty.state != ev->xproperty.state)
+				continue;
+			break;
+		case ConfigureRequest:
+			/* only when every field of the old request is overridden */
+			if(o->xconfigurerequest.value_mask & ~ev->xconfigurerequest.value_mask)
+				return;
+			break;
+		}
+		evstats.coalesced[o->type]++;
+		o->type = 0; /* no handler */
+		return;
+	}
+}
+
+void
+printstats(void) {
+	/* what coalesce() merges, and what xsync() is counted under: the
+	 * handled events, 0 for round trips made outside them */
+	static const char *names[LASTEvent] = {
+		[0] = "(no event)",
+		[ButtonPress] = "ButtonPress",
+		[ClientMessage] = "ClientMessage",
+		[ConfigureNotify] = "ConfigureNotify",
+		[ConfigureRequest] = "ConfigureRequest",
+		[DestroyNotify] = "DestroyNotify",
+		[EnterNotify] = "EnterNotify",
+		[Expose] = "Expose",
+		[FocusIn] = "FocusIn",
+		[KeyPress] = "KeyPress",
+		[MappingNotify] = "MappingNotify",
+		[MapRequest] = "MapRequest",
+		[MotionNotify] = "MotionNotify",
+		[PropertyNotify] = "PropertyNotify",
+		[ResizeRequest] = "ResizeRequest",
+		[UnmapNotify] = "UnmapNotify"
+	};
+	unsigned long total = 0, syncs = 0;
+	int i;
+
+	for(i = 0; i < LASTEvent; i++) {
+		total += evstats.coalesced[i];
+		syncs += evstats.syncs[i];
+	}
+	fprintf(stderr, "dwm: %lu events in %lu batches, %lu coalesced, %lu syncs\n",
+	        evstats.read, evstats.batches, total, syncs);
+	for(i = 0; i < LASTEvent; i++)
+		if(evstats.coalesced[i])
+			fprintf(stderr, "dwm:   %-16s %lu coalesced\n", names[i] ? names[i] : "?",
+			        evstats.coalesced[i]);
+	for(i = 0; i < LASTEvent; i++)
+		if(evstats.syncs[i])
+			fprintf(stderr, "dwm:   %-16s %lu syncs\n", names[i] ? names[i] : "?", evstats.syncs[i]);
+}
+
+const char *
+rulefield(const Rule *r, int field) {
+	return field == RuleClass ? r->class : field == RuleInstance ? r->instance : r->title;
+}
+
+/* ors into hits the rules whose pattern occurs in s, like strstr() would */
+void
+rulescan(const RuleMatcher *rm, const char *s, unsigned long *hits) {
+	const unsigned char *p;
+	unsigned int i, st;
+
+	for(st = 0, p = (const unsigned char *)s; *p; p++) {
+		st = rm->delta[st * rm->nclasses + rm->cls[*p]];
+		if(rm->term[st])
+			for(i = 0; i < RULEWORDS; i++)
+				hits[i] |= rm->out[st * RULEWORDS + i];
+	}
+}
+
+#ifdef XRANDR
+/* RRScreenChangeNotify and RRNotify: outputs came, went or moved */
+void
+rrnotify(XEvent *e) {
+	XRRUpdateConfiguration(e);
+	if(updategeom())
+		updatemons();
 }
+#endif /* XRANDR */
 
 void
 run(void) {
-	XEvent ev;
+	static XEvent q[EVBATCH];
+	int i, n;
 
 	/* main event loop */
 	XSync(dpy, False);
-	while(running && !XNextEvent(dpy, &ev)) {
-        /*//TODO: deleteme:*/
-        /*if (ev.type != 6 ) {*/
-            /*fprintf(stderr, "  @ run(): event type: %d\n", ev.type);*/
-            /*fprintf(stderr, "  @ run(): curview: %d\n", selmon->curtag);*/
-        /*}*/
-		if(handler[ev.type])
-			handler[ev.type](&ev); /* call handler */
-    }
+	flushbars();
+	while(running) {
+		/* block for one event, then drain whatever else is pending.  A
+		 * batch ends at a key or button press since those handlers may
+		 * grab and read the queue themselves (movemouse, resizemouse) */
+		XNextEvent(dpy, &q[0]);
+		for(n = 1; n < EVBATCH && q[n - 1].type != KeyPress
+		    && q[n - 1].type != ButtonPress && XPending(dpy); n++) {
+			XNextEvent(dpy, &q[n]);
+			coalesce(q, n + 1);
+		}
+		evstats.read += n;
+		evstats.batches++;
+		for(i = 0; i < n && running; i++)
+			if(q[i].type < LASTEvent && handler[q[i].type]) {
+				curevent = q[i].type;
+				handler[q[i].type](&q[i]); /* call handler */
+			}
+#ifdef XRANDR
+			else if(hasrandr && (q[i].type == rrevbase + RRScreenChangeNotify
+			                     || q[i].type == rrevbase + RRNotify))
+				rrnotify(&q[i]);
+#endif /* XRANDR */
+		curevent = 0;
+		flushbars();
+		XFlush(dpy); /* the only flush of this batch's requests */
+		if(dumpstats) {
+			dumpstats = 0;
+			printstats();
+		}
+	}
 }
 
 void
 runorraise(const Arg *arg) {
     char *app = ((char **)arg->v)[4];
     Arg a = { .ui = ~0 };
-    Monitor *mon;
+    const InternEntry *e = internlookup(app);
     Client *c;
-    XClassHint hint = { NULL, NULL };
-    /* Tries to find the client by res_class hint */
-    for (mon = mons; mon; mon = mon->next) {
-        for (c = mon->clients; c; c = c->next) {
-            XGetClassHint(dpy, c->win, &hint);
-            if (hint.res_class && strcmp(app, hint.res_class) == 0) {
-                a.ui = c->tags;
-                view(&a);
-                focus(c);
-                XRaiseWindow(dpy, c->win);
-                return;
-            }
-        }
+    /* Tries to find the client by res_class hint: the most recently focused
+     * one, or the least recently focused when already in that app, so that
+     * repeated presses cycle through all of its windows */
+    if (e && e->mru) {
+        c = selmon->sel && selmon->sel->resClass == e->str ? e->lru : e->mru;
+        a.ui = c->tags;
+        view(&a);
+        focus(c);
+        XRaiseWindow(dpy, c->win);
+        return;
     }
     /* Client not found: spawn it */
     spawn(arg);
 }
 
+/* relink the client (or stack) list of m in the order of the snapshot;
+ * clients without a record keep their relative order at the end */
+static void
+reorder(Monitor *m, Bool stack) {
+	Client *c, **v, **l;
+	long *rec, *key, k;
+	unsigned int i, j, n;
+
+	for(n = 0, c = stack ? m->stack : m->clients; c; c = stack ? c->snext : c->next, n++);
+	if(n < 2)
+		return;
+	if(!(v = malloc(n * (sizeof *v + sizeof *key))))
+		die("fatal: could not malloc() %u bytes\n", n * (sizeof *v + sizeof *key));
+	key = (long *)(v + n);
+	for(i = 0, c = stack ? m->stack : m->clients; c; c = stack ? c->snext : c->next, i++) {
+		rec = winindexget(&snapidx, c->win);
+		k = rec ? rec[stack ? 14 : 13] : LONG_MAX;
+		for(j = i; j > 0 && key[j - 1] > k; j--) {
+			key[j] = key[j - 1];
+			v[j] = v[j - 1];
+		}
+		key[j] = k;
+		v[j] = c;
+	}
+	l = stack ? &m->stack : &m->clients;
+	for(i = 0; i < n; i++) {
+		*l = v[i];
+		l = stack ? &v[i]->snext : &v[i]->next;
+	}
+	*l = NULL;
+	free(v);
+}
+
+/* finish a restore once scan() has managed every window */
+void
+restorestate(void) {
+	unsigned long i, numtags = LENGTH(tags) + 1;
+	long *p;
+	Client *c;
+	Monitor *m;
+
+	for(m = mons; m; m = m->next) {
+		reorder(m, False);
+		reorder(m, True);
+	}
+	for(i = 0, p = snapshot + STATEHDR; i < snapshot[2]; i++, p += STATEMON(numtags)) {
+		for(m = mons; m && m->num != p[0]; m = m->next);
+		if(m && (c = wintoclient(p[11])) && c->mon == m)
+			m->sel = c;
+	}
+	free(snapidx.tab);
+	memset(&snapidx, 0, sizeof snapidx);
+	XFree(snapshot);
+	snapshot = NULL;
+}
+
+static long
+layoutidx(const Layout *l) {
+	long i;
+
+	for(i = 0; i < LENGTH(layouts); i++)
+		if(l == &layouts[i])
+			return i;
+	return -1;
+}
+
+/* leave the state which a restart would lose in _DWM_STATE on the root
+ * window, as a flat array of longs: a header, a record per monitor and one
+ * per client; loadstate() and manage() read it back */
+void
+savestate(void) {
+	unsigned long n = STATEHDR, nmons = 0, nclients = 0;
+	int i, j, numtags = LENGTH(tags) + 1;
+	long *snap, *p;
+	Client *c, *d;
+	Monitor *m;
+
+	for(m = mons; m; m = m->next, nmons++)
+		for(c = m->clients; c; c = c->next, nclients++);
+	n += nmons * STATEMON(numtags) + nclients * STATECLIENT;
+	if(!(snap = p = calloc(n, sizeof(long))))
+		die("fatal: could not malloc() %u bytes\n", n * sizeof(long));
+	*p++ = STATEMAGIC;
+	*p++ = numtags;
+	*p++ = nmons;
+	*p++ = nclients;
+	*p++ = selmon->num;
+	p += 3; /* unused, was the Alt+Tab pair; the stack order is kept below */
+	for(m = mons; m; m = m->next) {
+		*p++ = m->num;
+		*p++ = m->seltags;
+		*p++ = m->sellt;
+		*p++ = m->tagset[0];
+		*p++ = m->tagset[1];
+		*p++ = m->curtag;
+		*p++ = m->prevtag;
+		*p++ = m->showbar;
+		*p++ = m->showtab;
+		*p++ = layoutidx(m->lt[0]);
+		*p++ = layoutidx(m->lt[1]);
+		*p++ = m->sel ? m->sel->win : None;
+		for(i = 0; i < numtags; i++)
+			*p++ = layoutidx(m->lts[i]);
+		for(i = 0; i < numtags; i++)
+			*p++ = m->mfacts[i] * STATEFIXED;
+		for(i = 0; i < numtags; i++)
+			*p++ = m->nmasters[i];
+	}
+	for(m = mons; m; m = m->next)
+		for(i = 0, c = m->clients; c; c = c->next, i++) {
+			for(j = 0, d = m->stack; d && d != c; d = d->snext, j++);
+			*p++ = c->win;
+			*p++ = m->num;
+			*p++ = c->tags;
+			*p++ = c->isfloating;
+			*p++ = c->cfact * STATEFIXED;
+			*p++ = c->sfx;
+			*p++ = c->sfy;
+			*p++ = c->sfw;
+			*p++ = c->sfh;
+			*p++ = c->x;
+			*p++ = c->y;
+			*p++ = c->w;
+			*p++ = c->h;
+			*p++ = i;
+			*p++ = j;
+		}
+	XChangeProperty(dpy, root, wmatom[WMDwmState], XA_CARDINAL, 32,
+	                PropModeReplace, (unsigned char *)snap, n);
+	XSync(dpy, False);
+	free(snap);
+}
+
 void
 scan(void) {
 	unsigned int i, num;
 	Window d1, d2, *wins = NULL;
-	XWindowAttributes wa;
+	WinProps *wp;
 
 	if(XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
+		if(!(wp = malloc(num * sizeof(WinProps) + 1)))
+			die("fatal: could not malloc() %u bytes\n", num * sizeof(WinProps));
+		getprops(wins, wp, num);
+		scanning = True;
 		for(i = 0; i < num; i++) {
-			if(!XGetWindowAttributes(dpy, wins[i], &wa)
-			|| wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1))
+			if(!wp[i].hasattrs || wp[i].wa.override_redirect || wp[i].hastrans)
 				continue;
-			if(wa.map_state == IsViewable || getstate(wins[i]) == IconicState)
-				manage(wins[i], &wa);
+			if(wp[i].wa.map_state == IsViewable || wp[i].wmstate == IconicState)
+				manage(wins[i], &wp[i]);
 		}
 		for(i = 0; i < num; i++) { /* now the transients */
-			if(!XGetWindowAttributes(dpy, wins[i], &wa))
+			if(!wp[i].hasattrs || wp[i].wa.override_redirect)
 				continue;
-			if(XGetTransientForHint(dpy, wins[i], &d1)
-			&& (wa.map_state == IsViewable || getstate(wins[i]) == IconicState))
-				manage(wins[i], &wa);
+			if(wp[i].hastrans
+			&& (wp[i].wa.map_state == IsViewable || wp[i].wmstate == IconicState))
+				manage(wins[i], &wp[i]);
 		}
+		scanning = False;
+		free(wp);
 		if(wins)
 			XFree(wins);
 	}
+	if(snapshot)
+		restorestate();
+	focus(NULL);
+	arrange(NULL);
 }
 
 // orig:
@@ -3176,6 +4111,7 @@ sendmon(Client *c, Monitor *m) {
 	detach(c);
 	detachstack(c);
 	c->mon = m;
+	c->home = NULL;
     // instead of assigning tags of target monitor, leave the old ones:
 	/*c->tags = m->tagset[m->seltags]; [> assign tags of target monitor <]*/
 	attach(c);
@@ -3243,6 +4179,7 @@ setfullscreen(Client *c, Bool fullscreen) {
 		c->oldbw = c->bw;
 		c->bw = 0;
 		c->isfloating = True;
+		c->mon->visdirty = True;
 		resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
 		XRaiseWindow(dpy, c->win);
 	}
@@ -3300,7 +4237,7 @@ setlayout(const Arg *arg) {
 	if(selmon->sel) // if there is selected window:
 		arrange(selmon);
 	else
-		drawbar(selmon);
+		markdirty(selmon, DirtyLtSymbol);
 }
 
 void storeFloats(Client *c) {
@@ -3321,11 +4258,8 @@ void restoreFloats(Client *c) {
 }
 
 int countvisiblenonfloatingclients() {
-    int i;
-    Client *c;
-
-    for(i = 0, c = selmon->clients; c; i += (ISVISIBLE(c) && !c->isfloating) ? 1 : 0, c = c->next);
-    return i;
+    updatevis(selmon);
+    return selmon->nvis[ListTiled];
 }
 
 void setcfact(const Arg *arg) {
@@ -3406,12 +4340,40 @@ setmfact(const Arg *arg) {
 	arrange(selmon);
 }
 
+/* the buffer only grows, titles that change in place reuse it */
+void
+setname(Client *c, const char *name) {
+	unsigned int n = strlen(name) + 1;
+
+	if(n > c->namesize) {
+		free(c->name);
+		if(!(c->name = malloc(n)))
+			die("fatal: could not malloc() %u bytes\n", n);
+		c->namesize = n;
+	}
+	memcpy(c->name, name, n);
+	c->namehash = strhash(c->name);
+}
+
 void
 setup(void) {
 	XSetWindowAttributes wa;
+	unsigned int i;
+#if defined(XSYNC) || defined(XRANDR)
+	int major, minor;
+#endif
+#ifdef XSYNC
+	int syncerr;
+#endif /* XSYNC */
+#ifdef XRANDR
+	int rrerr;
+#endif /* XRANDR */
 
 	/* clean up any zombies immediately */
 	sigchld(0);
+	/* print event statistics on SIGUSR1 */
+	if(signal(SIGUSR1, sigusr1) == SIG_ERR)
+		die("Can't install SIGUSR1 handler");
 
 	/* init screen */
 	screen = DefaultScreen(dpy);
@@ -3421,16 +4383,27 @@ setup(void) {
 	sh = DisplayHeight(dpy, screen);
 	bh = dc.h = dc.font.height;
     th = bh;
+#ifdef XRANDR
+	hasrandr = XRRQueryExtension(dpy, &rrevbase, &rrerr)
+	           && XRRQueryVersion(dpy, &major, &minor)
+	           && (major > 1 || (major == 1 && minor >= 5));
+	if(hasrandr)
+		XRRSelectInput(dpy, root, RRScreenChangeNotifyMask|RRCrtcChangeNotifyMask|RROutputChangeNotifyMask);
+#endif /* XRANDR */
 	updategeom();
 	/* init atoms */
 	wmatom[WMProtocols] = XInternAtom(dpy, "WM_PROTOCOLS", False);
 	wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
 	wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
 	wmatom[WMTakeFocus] = XInternAtom(dpy, "WM_TAKE_FOCUS", False);
+	wmatom[WMDwmState] = XInternAtom(dpy, "_DWM_STATE", False);
+	wmatom[WMSyncRequest] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+	wmatom[WMSyncCounter] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER", False);
 	netatom[NetActiveWindow] = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
 	netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
     netatom[NetWMDemandsAttention] = XInternAtom(dpy, "_NET_WM_STATE_DEMANDS_ATTENTION", False);
 	netatom[NetWMName] = XInternAtom(dpy, "_NET_WM_NAME", False);
+	netatom[NetWMIcon] = XInternAtom(dpy, "_NET_WM_ICON", False);
    netatom[NetSystemTray] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_S0", False);
    netatom[NetSystemTrayOP] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_OPCODE", False);
    netatom[NetSystemTrayOrientation] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_ORIENTATION", False);
@@ -3441,6 +4414,10 @@ setup(void) {
 	netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
 	netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
 	netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
+#ifdef XSYNC
+	hassync = XSyncQueryExtension(dpy, &syncevbase, &syncerr)
+	          && XSyncInitialize(dpy, &major, &minor);
+#endif /* XSYNC */
 	/* init cursors */
 	cursor[CurNormal] = XCreateFontCursor(dpy, XC_left_ptr);
 	/*cursor[CurResize] = XCreateFontCursor(dpy, XC_sizing);*/
@@ -3461,12 +4438,13 @@ setup(void) {
     }
 	dc.drawable = XCreatePixmap(dpy, root, DisplayWidth(dpy, screen), bh, DefaultDepth(dpy, screen));
 	dc.tabdrawable = XCreatePixmap(dpy, root, DisplayWidth(dpy, screen), th, DefaultDepth(dpy, screen));
-    // TODO: should the width be so huge?
-	dc.celldrawable = XCreatePixmap(dpy, root, 300, 300, DefaultDepth(dpy, screen));
 	dc.gc = XCreateGC(dpy, root, 0, NULL);
 	XSetLineAttributes(dpy, dc.gc, 1, LineSolid, CapButt, JoinMiter);
 	if(!dc.font.set)
 		XSetFont(dpy, dc.gc, dc.font.xfont->fid);
+	compilerules();
+	/* pick up where a reload() left off */
+	loadstate();
    /* init system tray */
    updatesystray();
 	/* init bars */
@@ -3477,7 +4455,9 @@ setup(void) {
 			PropModeReplace, (unsigned char *) netatom, NetLast);
 	/* select for events */
 	wa.cursor = cursor[CurNormal];
-	wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask|ButtonPressMask|PointerMotionMask
+	/* no PointerMotionMask: monitor changes over the bare root come as
+	 * crossings of the monitors' crosswins, see crossmon() */
+	wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask|ButtonPressMask
 			|EnterWindowMask|LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
 	XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
 	XSelectInput(dpy, root, wa.event_mask);
@@ -3485,25 +4465,15 @@ setup(void) {
 
     initfont2(cellFont, &cellDC); // recall initfont on cellDC, so the original (dc's) font could be overwritten
     cellDC.h = cellDC.font.height;
+	/* icons keep two pixels off the edges of whatever they sit in */
+	iconsz[IconBar] = MAX(1, MIN(ICONCELL, bh - 4));
+	iconsz[IconTab] = MAX(1, MIN(ICONCELL, th - 4));
+	iconsz[IconCell] = MAX(1, MIN(ICONCELL, cellDC.h - 4));
+	for(i = 0; i < LENGTH(tags); i++)
+		tagw[i] = TEXTW(tags[i].name);
 	grabkeys();
 }
 
-void
-showhide(Client *c) {
-	if(!c)
-		return;
-	if(ISVISIBLE(c)) { /* show clients top down */
-		XMoveWindow(dpy, c->win, c->x, c->y);
-		if((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) && !c->isfullscreen)
-			resize(c, c->x, c->y, c->w, c->h, False);
-		showhide(c->snext);
-	}
-	else { /* hide clients bottom up */
-		showhide(c->snext);
-		XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
-	}
-}
-
 void
 sigchld(int unused) {
 	if(signal(SIGCHLD, sigchld) == SIG_ERR)
@@ -3512,7 +4482,51 @@ sigchld(int unused) {
 }
 
 void
-spawn(const Arg *arg) {
+sigusr1(int unused) {
+	dumpstats = 1;
+}
+
+/* EnterNotify events caused by requests issued so far would steal focus; the
+ * NoOp makes every later crossing carry a serial of at least enterserial */
+void
+skipenter(void) {
+	enterserial = NextRequest(dpy);
+	XNoOp(dpy);
+}
+
+/* the edge of edges[l] nearest to v, if it is closer than *best and its
+ * extent touches [lo, hi]; a binary search skips everything out of reach */
+void
+snapedge(int l, int v, int lo, int hi, int *to, int *best) {
+	SnapEdge *e = edges[l];
+	int a = 0, b = nedges[l], i, d;
+
+	while(a < b) {
+		i = (a + b) / 2;
+		if(e[i].pos <= v - *best)
+			a = i + 1;
+		else
+			b = i;
+	}
+	for(; a < nedges[l] && e[a].pos < v + *best; a++)
+		if(e[a].lo <= hi && e[a].hi >= lo && (d = abs(e[a].pos - v)) < *best) {
+			*best = d;
+			*to = e[a].to;
+		}
+}
+
+/* FNV-1a */
+unsigned int
+strhash(const char *s) {
+	unsigned int h = 2166136261U;
+
+	while(*s)
+		h = (h ^ (unsigned char)*s++) * 16777619U;
+	return h;
+}
+
+void
+spawn(const Arg *arg) {
 	if(fork() == 0) {
 		if(dpy)
 			close(ConnectionNumber(dpy));
@@ -3540,96 +4554,86 @@ tagmon(const Arg *arg) {
 	sendmon(selmon->sel, dirtomon(arg->i));
 }
 
-int
-textnw(const char *text, unsigned int len) {
-    // remove non-printing color codes before calculating width
-    char *ptr = (char *) text;
-    unsigned int i, ibuf, lenbuf=len;
-    char buf[len+1];
+static int
+glyphadv(struct Fnt *font, wchar_t wc, const char *s, int n) {
 	XRectangle r;
+	int i = (unsigned long)wc % GLYPHCACHE;
 
-     for(i=0, ibuf=0; *ptr && i<len; i++, ptr++) {
-    if(*ptr <= NUMCOLORS && *ptr > 0) {
-        if (i < len) { lenbuf--; }
-        } else {
-        buf[ibuf]=*ptr;
-        ibuf++;
-        }
-    }
- buf[ibuf]=0;
-
-	if(dc.font.set) {
-    XmbTextExtents(dc.font.set, buf, lenbuf, NULL, &r);
-		return r.width;
+	if(font->glyphs[i].cp != wc) {
+		font->glyphs[i].cp = wc;
+		if(font->set) {
+			XmbTextExtents(font->set, s, n, NULL, &r);
+			font->glyphs[i].adv = r.width;
+		}
+		else
+			font->glyphs[i].adv = XTextWidth(font->xfont, s, n);
 	}
-	return XTextWidth(dc.font.xfont, buf, lenbuf);
+	return font->glyphs[i].adv;
 }
 
-void
-tile(Monitor *m) {
-	unsigned int i, n, h, mw, my, ty, r;
-	float mfacts = 0, sfacts = 0;
-	Client *c;
-
-    // Collect the cfacts:
-	for(n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++) {
-        // TODO: siin vist korjatakse kõik vastava area (st master v stack)
-        // factid kokku, et saaks kliente omavahel võrrelda;
-		if(n < m->nmasters[m->curtag])
-			mfacts += c->cfact;
+/* width of the first len bytes of text, leaving out colour codes and taking
+ * bytes past the end of text as spaces.  With fit, stops before the first
+ * character which would make it wider than max, and stores the length of
+ * the prefix that fits */
+int
+textfit(struct Fnt *font, const char *text, unsigned int len, int max, unsigned int *fit) {
+	mbstate_t ps;
+	wchar_t wc;
+	size_t n;
+	unsigned int i;
+	int a, w = 0;
+	Bool end = False;
+
+	memset(&ps, 0, sizeof ps);
+	for(i = 0; i < len; i += n) {
+		n = 1;
+		if(end || !text[i]) {
+			end = True;
+			a = glyphadv(font, L' ', " ", 1);
+		}
+		else if(text[i] > 0 && text[i] <= NUMCOLORS)
+			a = 0;
+		else if(font->set) {
+			n = mbrtowc(&wc, text + i, len - i, &ps);
+			if(n == (size_t)-1 || n == (size_t)-2) { /* measure a stray byte on its own */
+				memset(&ps, 0, sizeof ps);
+				wc = 0xdc00 | (unsigned char)text[i];
+				n = 1;
+			}
+			a = glyphadv(font, wc, text + i, n);
+		}
 		else
-			sfacts += c->cfact;
+			a = glyphadv(font, (unsigned char)text[i], text + i, 1);
+		if(fit && w + a > max)
+			break;
+		w += a;
 	}
-	if(n == 0)
-		return;
+	if(fit)
+		*fit = MIN(i, len);
+	return w;
+}
 
-	if(n > m->nmasters[m->curtag]) // if more clients than master slots
-		mw = m->nmasters[m->curtag] ? m->ww * m->mfacts[m->curtag] : 0;
-	else
-		mw = m->ww;
-	for(i = my = ty = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++, r = 0) {
-		if(n == 1) {
-			if (c->bw) {
-				/* remove border when only one window is on the current tag */
-				c->oldbw = c->bw;
-				c->bw = 0;
-				r = 1;
-			}
-		} else if(!c->bw && c->oldbw) {
-			/* restore border when more than one window is displayed */
-			c->bw = c->oldbw;
-			c->oldbw = 0;
-			r = 1;
-		}
-        // TODO: cfacts tekitab siin pertagi patchiga segadust
-		/*if(i < m->nmaster) {*/ // oli enne
-			/*h = (m->wh - my) * (c->cfact / mfacts);*/ // oli enne
-/*-	          h = (m->wh - my) / (MIN(n, m->nmaster) - i);*/ // seda tahtis pertag patch eemaldada
-		if(i < m->nmasters[m->curtag]) { // ie we're processing master area client
-			/*h = (m->wh - my) / (MIN(n, m->nmasters[m->curtag]) - i);*/ // see oli koos pertagi ja ctagiga; ilmselgelt välistab see cfacti funktsionaalsuse;
-            h = (m->wh - my) * (c->cfact / mfacts); // oli enne
-			resize(c,
-                   m->wx,
-                   m->wy + my,
-                   mw - (2*c->bw),
-                   h - (2*c->bw),    False);
-			if(r)
-				resizeclient(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw));
-			my += HEIGHT(c);
-			mfacts -= c->cfact;
-		} else { // slave stack;
-			h = (m->wh - ty) * (c->cfact / sfacts);
-			resize(c,
-                   m->wx + mw,
-                   m->wy + ty,
-                   m->ww - mw - (2*c->bw),
-                   h - (2*c->bw),    False);
-			if(r)
-				resizeclient(c, m->wx + mw, m->wy + ty, m->ww - mw - (2*c->bw), h - (2*c->bw));
-			ty += HEIGHT(c);
-			sfacts -= c->cfact;
+int
+textnw(const char *text, unsigned int len) {
+	return textfit(&dc.font, text, len, 0, NULL);
+}
+
+/* text of a fetched text property, truncated to size */
+void
+textprop(XTextProperty *name, char *text, unsigned int size) {
+	char **list = NULL;
+	int n;
+
+	text[0] = '\0';
+	if(name->encoding == XA_STRING)
+		snprintf(text, size, "%.*s", (int)name->nitems, (char *)name->value);
+	else {
+		if(XmbTextPropertyToTextList(dpy, name, &list, &n) >= Success && n > 0 && *list) {
+			strncpy(text, *list, size - 1);
+			XFreeStringList(list);
 		}
 	}
+	text[size - 1] = '\0';
 }
 
 void
@@ -3744,6 +4748,7 @@ unmanage(Client *c, Bool destroyed) {
 	/* The server grab construct avoids race conditions. */
 	detach(c);
 	detachstack(c);
+	detachclass(c);
 	if(!destroyed) {
 		wc.border_width = c->oldbw;
 		XGrabServer(dpy);
@@ -3751,21 +4756,15 @@ unmanage(Client *c, Bool destroyed) {
 		XConfigureWindow(dpy, c->win, CWBorderWidth, &wc); /* restore border */
 		XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
 		setclientstate(c, WithdrawnState);
-		XSync(dpy, False);
+		xsync();
 		XSetErrorHandler(xerror);
 		XUngrabServer(dpy);
 	}
-    // TODO: is this required?
-    // clean client from alttab stack, if present:
-    int arrLen = sizeof(clt) / sizeof(clt[0]);
-    for (int i = 0; i < arrLen; i++) {
-        if (clt[i] == c) {
-            clt[i] = NULL;
-            /*break;*/
-        }
-    }
-
-	free(c);
+	winindexdel(&clientidx, c->win);
+	if(c->tabpm)
+		XFreePixmap(dpy, c->tabpm);
+	free(c->icon[0]);
+	freeclient(c);
 	focus(NULL);
 	arrange(m);
 }
@@ -3774,6 +4773,9 @@ Bool isWindowClassByWin(Window w, char *class) {
     if (!w) return False;
     if (!class) return False;
 
+    Client *c = wintoclient(w);
+    if (c) return strstr(c->className, class) != NULL; /* cached at manage() */
+
     char w_class[256];
     /*char w_name[512];*/
     /*const char idea_name[] = "IntelliJ IDEA";*/
@@ -3805,24 +4807,6 @@ Bool isWindowClassByWin(Window w, char *class) {
     return False;
 }
 
-Bool isWindowInSkipList(Client *c) {
-    if (!c || !c->win) return False;
-    /*char w_class[256];*/
-
-    /*gettextprop(c->win, XA_WM_CLASS, w_class, sizeof w_class);*/
-
-    for (const char **winClass = ignored_class_list; *winClass; winClass++ ) {
-        /*if ( strstr( w_class, *winClass ) ) {*/
-        if ( strstr( c->className, *winClass ) ) {
-            /*fprintf(stderr, "  @isWindowClass: %s class detected, returning true\n", w_class);*/
-            return True;
-        }
-    }
-
-    return False;
-    /*return isWindowClass(c, client_class_notifyd);*/
-}
-
 Bool isWindowClass(Client *c, const char *class) {
     if (!c || !c->win) return False;
     if (!class) return False;
@@ -3862,11 +4846,7 @@ Bool isWindowName(Client *c, char *name) {
     if (!c || !c->win) return False;
     if (!name) return False;
 
-    char w_name[512];
-
-    if(!gettextprop(c->win, netatom[NetWMName], w_name, sizeof w_name)) {
-        gettextprop(c->win, XA_WM_NAME, w_name, sizeof w_name);
-    }
+    /* c->name is kept current by updatetitle() */
 
     /*fprintf(stderr, "class: %s\n", w_class);*/
     /*fprintf(stderr, "name: %s\n", w_name);*/
@@ -3877,7 +4857,7 @@ Bool isWindowName(Client *c, char *name) {
         /*[>fprintf(stderr, "  !! idea class detected!\n");<]*/
         /*return True;*/
     /*}*/
-    if ( strstr(w_name, name) ) {
+    if ( strstr(c->name, name) ) {
         return True;
     }
 
@@ -3897,11 +4877,52 @@ unmapnotify(XEvent *e) {
 	}
    else if((c = wintosystrayicon(ev->window))) {
        removesystrayicon(c);
-       resizebarwin(selmon);
-       updatesystray();
+       markdirty(selmon, DirtySystray);
    }
 }
 
+#ifdef XRANDR
+/* m is back in mons: its clients return from wherever parkmon() put them,
+ * keeping their tags, in one pass over the other monitors */
+void
+unparkclients(Monitor *m) {
+	Monitor *o;
+	Client *c, **tc, **hc = &m->clients, **hs = &m->stack;
+
+	for(o = mons; o; o = o->next) {
+		if(o == m)
+			continue;
+		for(tc = &o->clients; (c = *tc);)
+			if(c->home == m) {
+				*tc = c->next;
+				c->mon = m;
+				c->home = NULL;
+				*hc = c;
+				hc = &c->next;
+				o->resized = True;
+			}
+			else
+				tc = &c->next;
+		for(tc = &o->stack; (c = *tc);)
+			if(c->mon == m) {
+				*tc = c->snext;
+				*hs = c;
+				hs = &c->snext;
+			}
+			else
+				tc = &c->snext;
+		if(o->sel && o->sel->mon != o)
+			o->sel = NULL;
+		o->visdirty = True;
+	}
+	*hc = NULL;
+	*hs = NULL;
+	for(c = m->stack; c && !ISVISIBLE(c); c = c->snext);
+	m->sel = c;
+	m->visdirty = m->resized = True;
+}
+#endif /* XRANDR */
+
 void
 updatebars(void) {
    unsigned int w;
@@ -3911,7 +4932,11 @@ updatebars(void) {
 		.background_pixmap = ParentRelative,
 		.event_mask = ButtonPressMask|ExposureMask
 	};
+	XSetWindowAttributes cwa = { .override_redirect = True, .event_mask = EnterWindowMask };
+
 	for(m = mons; m; m = m->next) {
+		if(m->barwin)
+			continue;
        w = m->ww;
        if(showsystray && m == selmon)
            w -= getsystraywidth();
@@ -3925,15 +4950,26 @@ updatebars(void) {
 					  CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
 		XDefineCursor(dpy, m->tabwin, cursor[CurNormal]);
 		XMapRaised(dpy, m->tabwin);
-        // TODO: need to define cellwin stuff here? seek for other places where
-        // cellwin stuff needs to be addressed in!
+		winindexput(&baridx, m->barwin, m);
+		winindexput(&baridx, m->tabwin, m);
+		m->dirty = DirtyAll;
+		/* mapped by altTab() only */
+		m->cellwin = XCreateWindow(dpy, root, m->wx, m->wy, cellWidth, 1, 0, DefaultDepth(dpy, screen),
+					  CopyFromParent, DefaultVisual(dpy, screen),
+					  CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
+		XDefineCursor(dpy, m->cellwin, cursor[CurNormal]);
+		/* clicks go on to root, which selects them */
+		m->crosswin = XCreateWindow(dpy, root, m->mx, m->my, m->mw, m->mh, 0, 0, InputOnly,
+					  CopyFromParent, CWOverrideRedirect|CWEventMask, &cwa);
+		XMapWindow(dpy, m->crosswin);
+		XLowerWindow(dpy, m->crosswin);
+		winindexput(&baridx, m->crosswin, m);
 	}
 }
 
 void
 updatebarpos(Monitor *m) {
-	Client *c;
-	int nvis = 0;
+	int nvis;
 
 	m->wy = m->my;
 	m->wh = m->mh;
@@ -3946,9 +4982,8 @@ updatebarpos(Monitor *m) {
 		m->by = -bh;
 	}
 
-	for(c = m->clients; c; c = c->next){
-	  if(ISVISIBLE(c) && !c->isInSkipList) ++nvis;
-	}
+	updatevis(m);
+	nvis = m->nvis[ListFocus];
 
 	if(m->showtab == showtab_always
         || (m->showtab == showtab_auto &&
@@ -3970,10 +5005,14 @@ Bool
 updategeom(void) {
 	Bool dirty = False;
 
+#ifdef XRANDR
+	if(hasrandr)
+		dirty = updaterandr();
+	else
+#endif /* XRANDR */
 #ifdef XINERAMA
 	if(XineramaIsActive(dpy)) {
 		int i, j, n, nn;
-		Client *c;
 		Monitor *m;
 		XineramaScreenInfo *info = XineramaQueryScreens(dpy, &nn);
 		XineramaScreenInfo *unique = NULL;
@@ -4012,20 +5051,17 @@ updategeom(void) {
 					m->my = m->wy = unique[i].y_org;
 					m->mw = m->ww = unique[i].width;
 					m->mh = m->wh = unique[i].height;
+					m->resized = True;
 					updatebarpos(m);
 				}
 		}
 		else { /* less monitors available nn < n */
 			for(i = nn; i < n; i++) {
 				for(m = mons; m && m->next; m = m->next);
-				while(m->clients) {
+				if(m->clients) {
 					dirty = True;
-					c = m->clients;
-					m->clients = c->next;
-					detachstack(c);
-					c->mon = mons;
-					attach(c);
-					attachstack(c);
+					mons->resized = True;
+					moveclients(m, mons);
 				}
 				if(m == selmon)
 					selmon = mons;
@@ -4044,6 +5080,7 @@ updategeom(void) {
 			dirty = True;
 			mons->mw = mons->ww = sw;
 			mons->mh = mons->wh = sh;
+			mons->resized = True;
 			updatebarpos(mons);
 		}
 	}
@@ -4054,6 +5091,26 @@ updategeom(void) {
 	return dirty;
 }
 
+/* brings bars and layouts of the monitors updategeom() changed up to date;
+ * the others are left alone */
+void
+updatemons(void) {
+	Monitor *m;
+
+	updatebars();
+	for(m = mons; m; m = m->next)
+		if(m->resized) {
+			resizebarwin(m);
+			XMoveResizeWindow(dpy, m->crosswin, m->mx, m->my, m->mw, m->mh);
+		}
+	focus(NULL);
+	for(m = mons; m; m = m->next)
+		if(m->resized) {
+			m->resized = False;
+			arrange(m);
+		}
+}
+
 void
 updatenumlockmask(void) {
 	unsigned int i, j;
@@ -4069,6 +5126,65 @@ updatenumlockmask(void) {
 	XFreeModifiermap(modmap);
 }
 
+#ifdef XRANDR
+/* matches the XRandR monitors to ours by name: only those whose geometry
+ * changed are touched, vanished ones are parked with their clients on the
+ * primary monitor and returning ones are taken out of parked again */
+Bool
+updaterandr(void) {
+	XRRMonitorInfo *info;
+	Monitor *m, **mp, *head = NULL, **tail = &head, *to;
+	int i, n;
+	Bool dirty = False;
+
+	if(!(info = XRRGetMonitors(dpy, root, True, &n)))
+		return False;
+	if(n <= 0) { /* everything off, keep the layout for when it comes back */
+		XRRFreeMonitors(info);
+		return False;
+	}
+	for(i = 0; i < n; i++) {
+		for(mp = &mons; *mp && (*mp)->output != info[i].name; mp = &(*mp)->next);
+		if(!*mp)
+			for(mp = &parked; *mp && (*mp)->output != info[i].name; mp = &(*mp)->next);
+		if((m = *mp))
+			*mp = m->next;
+		else {
+			m = createmon();
+			m->output = info[i].name;
+		}
+		*tail = m;
+		tail = &m->next;
+		m->num = i;
+		if(info[i].x != m->mx || info[i].y != m->my
+		|| info[i].width != m->mw || info[i].height != m->mh) {
+			dirty = True;
+			m->resized = True;
+			m->mx = m->wx = info[i].x;
+			m->my = m->wy = info[i].y;
+			m->mw = m->ww = info[i].width;
+			m->mh = m->wh = info[i].height;
+			updatebarpos(m);
+		}
+	}
+	*tail = NULL;
+	for(to = head, i = 0; i < n && !info[i].primary; i++, to = to->next);
+	if(!to)
+		to = head;
+	XRRFreeMonitors(info);
+	while((m = mons)) { /* what is left has no output any more */
+		dirty = True;
+		mons = m->next;
+		parkmon(m, to);
+	}
+	mons = head;
+	for(m = mons; m; m = m->next)
+		if(!m->barwin) /* unparked or new */
+			unparkclients(m);
+	return dirty;
+}
+#endif /* XRANDR */
+
 void
 updatesizehints(Client *c) {
 	long msize;
@@ -4077,6 +5193,13 @@ updatesizehints(Client *c) {
 	if(!XGetWMNormalHints(dpy, c->win, &size, &msize))
 		/* size is uninitialized, ensure that size.flags aren't used */
 		size.flags = PSize;
+	setsizehints(c, &size);
+}
+
+void
+setsizehints(Client *c, XSizeHints *hints) {
+	XSizeHints size = *hints;
+
 	if(size.flags & PBaseSize) {
 		c->basew = size.base_width;
 		c->baseh = size.base_height;
@@ -4121,28 +5244,40 @@ updatesizehints(Client *c) {
 
 void
 updatetitle(Client *c) {
-	if(!gettextprop(c->win, netatom[NetWMName], c->name, sizeof c->name))
-		gettextprop(c->win, XA_WM_NAME, c->name, sizeof c->name);
-	if(c->name[0] == '\0') /* hack to mark broken clients */
-		strcpy(c->name, broken);
-    // TODO: debug:
-    /*fprintf(stderr, "    !updatetitle(): title \"%s\"\n", c->name);*/
-}
+	char name[256];
 
-void
-updateClassName(Client *c) {
-    gettextprop(c->win, XA_WM_CLASS, c->className, sizeof c->className);
-	if(c->className[0] == '\0') /* hack to mark broken clients */
-		strcpy(c->className, broken);
+	if(!gettextprop(c->win, netatom[NetWMName], name, sizeof name))
+		gettextprop(c->win, XA_WM_NAME, name, sizeof name);
+	/* empty: hack to mark broken clients */
+	setname(c, name[0] ? name : broken);
     // TODO: debug:
-    /*fprintf(stderr, "    !updateClassName(): class \"%s\"\n", c->className);*/
+    /*fprintf(stderr, "    !updatetitle(): title \"%s\"\n", c->name);*/
 }
 
 void
 updatestatus(void) {
+	int i, col = 0, off = 0;
+
 	if(!gettextprop(root, XA_WM_NAME, stext, sizeof(stext)))
 		strcpy(stext, "dwm-"VERSION);
-	drawbar(selmon);
+	/* split at the colour codes once here rather than on every redraw; the
+	 * last segment is kept even if empty, it paints the rest of the bar */
+	memcpy(stbuf, stext, sizeof stbuf);
+	for(i = nstseg = stextw = 0; ; i++) {
+		if(stbuf[i] && (stbuf[i] < 0 || stbuf[i] > NUMCOLORS))
+			continue;
+		if(i > off || !stbuf[i]) {
+			stseg[nstseg].col = col;
+			stseg[nstseg].off = off;
+			stextw += stseg[nstseg++].w = textnw(stbuf + off, i - off);
+		}
+		if(!stbuf[i])
+			break;
+		col = stbuf[i] - 1;
+		stbuf[i] = '\0';
+		off = i + 1;
+	}
+	markdirty(selmon, DirtyStatus);
 }
 
 void
@@ -4173,7 +5308,7 @@ updatesystrayiconstate(Client *i, XPropertyEvent *ev) {
    int code = 0;
 
    if(!showsystray || !i || ev->atom != xatom[XembedInfo] ||
-           !(flags = getatomprop(i, xatom[XembedInfo])))
+           !(flags = getatomprop(i->win, xatom[XembedInfo])))
        return;
 
    if(flags & XEMBED_MAPPED && !i->tags) {
@@ -4220,7 +5355,7 @@ updatesystray(void) {
        XSetSelectionOwner(dpy, netatom[NetSystemTray], systray->win, CurrentTime);
        if(XGetSelectionOwner(dpy, netatom[NetSystemTray]) == systray->win) {
            sendevent(root, xatom[Manager], StructureNotifyMask, CurrentTime, netatom[NetSystemTray], systray->win, 0, 0);
-           XSync(dpy, False);
+           xsync();
        }
        else {
            fprintf(stderr, "dwm: unable to obtain system tray.\n");
@@ -4243,19 +5378,23 @@ updatesystray(void) {
    /* redraw background */
    XSetForeground(dpy, dc.gc, dc.colors[0][ColBG]);
    XFillRectangle(dpy, systray->win, dc.gc, 0, 0, w, bh);
-   XSync(dpy, False);
 }
 
 void
 updatewindowtype(Client *c) {
-	Atom state = getatomprop(c, netatom[NetWMState]);
-	Atom wtype = getatomprop(c, netatom[NetWMWindowType]);
+	setwindowtype(c, getatomprop(c->win, netatom[NetWMState]),
+	              getatomprop(c->win, netatom[NetWMWindowType]));
+}
 
+void
+setwindowtype(Client *c, Atom state, Atom wtype) {
 	if(state == netatom[NetWMFullscreen])
 		setfullscreen(c, True);
 
-	if(wtype == netatom[NetWMWindowTypeDialog])
+	if(wtype == netatom[NetWMWindowTypeDialog]) {
 		c->isfloating = True;
+		c->mon->visdirty = True;
+	}
 }
 
 void
@@ -4263,23 +5402,33 @@ updatewmhints(Client *c) {
 	XWMHints *wmh;
 
 	if((wmh = XGetWMHints(dpy, c->win))) {
-		if(c == selmon->sel && wmh->flags & XUrgencyHint) {
-			wmh->flags &= ~XUrgencyHint;
-			XSetWMHints(dpy, c->win, wmh);
-		}
-		else
-			c->isurgent = (wmh->flags & XUrgencyHint) ? True : False;
-            if (c->isurgent) {
-                XSetWindowBorder(dpy, c->win, dc.colors[ColUrg][ColBorder]);
-            }
-		if(wmh->flags & InputHint)
-			c->neverfocus = !wmh->input;
-		else
-			c->neverfocus = False;
+		setwmhints(c, wmh);
 		XFree(wmh);
 	}
 }
 
+void
+setwmhints(Client *c, XWMHints *wmh) {
+	if(c == selmon->sel && wmh->flags & XUrgencyHint) {
+		wmh->flags &= ~XUrgencyHint;
+		XSetWMHints(dpy, c->win, wmh);
+	}
+	else
+		c->isurgent = (wmh->flags & XUrgencyHint) ? True : False;
+        if (c->isurgent) {
+            XSetWindowBorder(dpy, c->win, dc.colors[ColUrg][ColBorder]);
+        }
+	if(wmh->flags & InputHint)
+		c->neverfocus = !wmh->input;
+	else
+		c->neverfocus = False;
+	if((wmh->flags & IconPixmapHint ? wmh->icon_pixmap : None) != c->iconhint) {
+		c->iconhint = wmh->flags & IconPixmapHint ? wmh->icon_pixmap : None;
+		c->iconvalid = False;
+		c->tabcol = NULL;
+	}
+}
+
 void
 view(const Arg *arg) {
     unsigned int i;
@@ -4307,18 +5456,102 @@ view(const Arg *arg) {
 	arrange(selmon);
 }
 
+/* the member of m->vis[l] after (dir > 0) or before c in list order,
+ * wrapping around; c itself need not be a member */
 Client *
-wintoclient(Window w) {
-	Client *c;
-	Monitor *m;
+visstep(Monitor *m, int l, Client *c, int dir) {
+	int n, pos;
+
+	updatevis(m);
+	if(!(n = m->nvis[l]))
+		return NULL;
+	pos = c->vispos[l];
+	if(dir > 0)
+		pos += c->visin >> l & 1;
+	else
+		pos = pos - 1 + n;
+	return m->vis[l][pos % n];
+}
 
-	for(m = mons; m; m = m->next)
-		for(c = m->clients; c; c = c->next)
-			if(c->win == w)
-				return c;
+static unsigned int
+winhash(Window w) {
+	return (unsigned int)((w ^ (w >> 16)) * 0x9E3779B1UL);
+}
+
+static void
+winindexgrow(WinIndex *idx) {
+	WinEntry *old = idx->tab;
+	unsigned int i, j, oldsize = idx->size;
+
+	idx->size = oldsize ? oldsize * 2 : 64;
+	if(!(idx->tab = calloc(idx->size, sizeof(WinEntry))))
+		die("fatal: could not malloc() %u bytes\n", idx->size * sizeof(WinEntry));
+	for(i = 0; i < oldsize; i++) {
+		if(!old[i].win)
+			continue;
+		for(j = winhash(old[i].win) & (idx->size - 1); idx->tab[j].win; j = (j + 1) & (idx->size - 1));
+		idx->tab[j] = old[i];
+	}
+	free(old);
+}
+
+void
+winindexdel(WinIndex *idx, Window w) {
+	unsigned int i, j, k, mask = idx->size - 1;
+
+	if(!w || !idx->size)
+		return;
+	for(i = winhash(w) & mask; idx->tab[i].win != w; i = (i + 1) & mask)
+		if(!idx->tab[i].win)
+			return;
+	/* backward shift, so lookups never need tombstones */
+	for(j = i;;) {
+		j = (j + 1) & mask;
+		if(!idx->tab[j].win)
+			break;
+		k = winhash(idx->tab[j].win) & mask;
+		if(i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		idx->tab[i] = idx->tab[j];
+		i = j;
+	}
+	idx->tab[i].win = None;
+	idx->tab[i].data = NULL;
+	idx->count--;
+}
+
+void *
+winindexget(WinIndex *idx, Window w) {
+	unsigned int i, mask = idx->size - 1;
+
+	if(!w || !idx->size)
+		return NULL;
+	for(i = winhash(w) & mask; idx->tab[i].win; i = (i + 1) & mask)
+		if(idx->tab[i].win == w)
+			return idx->tab[i].data;
 	return NULL;
 }
 
+void
+winindexput(WinIndex *idx, Window w, void *data) {
+	unsigned int i;
+
+	if(!w)
+		return;
+	if((idx->count + 1) * 4 > idx->size * 3)
+		winindexgrow(idx);
+	for(i = winhash(w) & (idx->size - 1); idx->tab[i].win && idx->tab[i].win != w; i = (i + 1) & (idx->size - 1));
+	if(!idx->tab[i].win)
+		idx->count++;
+	idx->tab[i].win = w;
+	idx->tab[i].data = data;
+}
+
+Client *
+wintoclient(Window w) {
+	return winindexget(&clientidx, w);
+}
+
 Monitor *
 wintomon(Window w) {
 	int x, y;
@@ -4327,9 +5560,8 @@ wintomon(Window w) {
 
 	if(w == root && getrootptr(&x, &y))
 		return recttomon(x, y, 1, 1);
-	for(m = mons; m; m = m->next)
-		if(w == m->barwin || w == m->tabwin)
-			return m;
+	if((m = winindexget(&baridx, w)))
+		return m;
 	if((c = wintoclient(w)))
 		return c->mon;
 	return selmon;
@@ -4337,12 +5569,9 @@ wintomon(Window w) {
 
 Client *
 wintosystrayicon(Window w) {
-   Client *i = NULL;
-
    if(!showsystray || !w)
-       return i;
-   for(i = systray->icons; i && i->win != w; i = i->next) ;
-   return i;
+       return NULL;
+   return winindexget(&trayidx, w);
 }
 
 /* There's no way to check accesses to destroyed windows, thus those cases are
@@ -4378,6 +5607,13 @@ xerrorstart(Display *dpy, XErrorEvent *ee) {
 	return -1;
 }
 
+/* round trips made while handling events go through here to be counted */
+void
+xsync(void) {
+	evstats.syncs[curevent]++;
+	XSync(dpy, False);
+}
+
 void
 zoom(const Arg *arg) {
 	Client *c = selmon->sel;
@@ -4434,6 +5670,7 @@ main(int argc, char *argv[]) {
 
 void
 reload(const Arg *arg) {
+       savestate();
        if (arg->v) {
               execvp(((char **)arg->v)[0], (char **)arg->v);
        } else {
@@ -4474,68 +5711,257 @@ tagcycle(const Arg *arg) {
 
 
 //////////////// ALT-TAB:
-Window
-getWindowIconWindow (Client *c) {
-	XWMHints *wmh;
-    Window icon_w = NULL;
+/* Alt+Tab: cycles through the visible clients of selmon in the order focus()
+ * keeps selmon->stack in, most recently focused first, for as long as Alt is
+ * held.  Shift+Tab goes back, Escape leaves the focus where it was. */
+void
+altTab(void) {
+	Monitor *m = selmon;
+	Client *cl[MAXTABS], *c;
+	XEvent ev;
+	KeySym ks = NoSymbol;
+	KeyCode altl = XKeysymToKeycode(dpy, XK_Alt_L), altr = XKeysymToKeycode(dpy, XK_Alt_R);
+	char keys[32];
+	int i, n;
+
+	for(n = 0, c = m->stack; c && n < MIN(MAXTABS, m->wh / cellDC.h); c = c->snext)
+		if(ISVISIBLE(c) && !(c->classflags & ClassSkip))
+			cl[n++] = c;
+	if(n < 2)
+		return;
+	i = 1;
+	if(XGrabKeyboard(dpy, root, True, GrabModeAsync, GrabModeAsync, CurrentTime) == GrabSuccess) {
+		/* Alt may be up already, then it was a quick tap */
+		XQueryKeymap(dpy, keys);
+		if((keys[altl / 8] & 1 << altl % 8) || (keys[altr / 8] & 1 << altr % 8)) {
+			drawswitcher(m, cl, n);
+			showcell(m, n, i, True);
+			do {
+				XMaskEvent(dpy, KeyPressMask|KeyReleaseMask|ExposureMask|SubstructureRedirectMask, &ev);
+				switch(ev.type) {
+				case Expose:
+					if(ev.xexpose.window != m->cellwin) {
+						expose(&ev);
+						break;
+					}
+					XCopyArea(dpy, cellDC.celldrawable, m->cellwin, cellDC.gc,
+					          0, 0, cellWidth, n * cellDC.h, 0, 0);
+					showcell(m, n, i, True);
+					break;
+				case ConfigureRequest:
+				case MapRequest:
+					handler[ev.type](&ev);
+					break;
+				case KeyPress:
+				case KeyRelease:
+					ks = XKeycodeToKeysym(dpy, (KeyCode)ev.xkey.keycode, 0);
+					if(ev.type == KeyPress && ks == XK_Tab) {
+						showcell(m, n, i, False);
+						i = (i + (ev.xkey.state & ShiftMask ? n - 1 : 1)) % n;
+						showcell(m, n, i, True);
+					}
+					break;
+				}
+			} while(ks != XK_Escape && !(ev.type == KeyRelease && (ks == XK_Alt_L || ks == XK_Alt_R)));
+			XUnmapWindow(dpy, m->cellwin);
+		}
+		XUngrabKeyboard(dpy, CurrentTime);
+	}
+	if(ks != XK_Escape) {
+		focus(cl[i]);
+		restack(m);
+	}
+}
 
-	if((wmh = XGetWMHints(dpy, c->win))) {
-        fprintf(stderr, "in getWinIconWindow: wmh is not null for %s :)\n ", c->name);
-        icon_w = wmh->icon_window;
-        if (!icon_w)
-            fprintf(stderr, "in getWinIconWindow: %s icon_w is NULL :((((\n", c->name);
-		/*if(wmh->flags & InputHint)*/
-			/*c->neverfocus = !wmh->input;*/
-		/*else*/
-			/*c->neverfocus = False;*/
-		XFree(wmh);
-	} else {
-        fprintf(stderr, "in getWinIconWindow: wmh IS NULL:(\n");
-    }
+/* renders a cell per client of cl into cellDC.celldrawable twice, normal
+ * colours above selected ones, and shows the normal set on m->cellwin.
+ * Icons are decoded once per client, see loadicon(). */
+void
+drawswitcher(Monitor *m, Client **cl, int n) {
+	static int cellph = 0;
+	unsigned long *col;
+	int i, s, y, ch = cellDC.h;
 
+	if(2 * n * ch > cellph) {
+		if(cellDC.celldrawable)
+			XFreePixmap(dpy, cellDC.celldrawable);
+		cellph = 2 * n * ch;
+		cellDC.celldrawable = XCreatePixmap(dpy, root, cellWidth, cellph, DefaultDepth(dpy, screen));
+	}
+	for(i = 0; i < n; i++)
+		for(s = 0; s < 2; s++) {
+			col = cellDC.colors[s ? 13 : 12];
+			y = cellDC.y = (s * n + i) * ch;
+			cellDC.x = 0;
+			cellDC.w = ch + ch / 2;
+			drawCells(cellDC.celldrawable, NULL, col, False);
+			drawicon(cellDC.celldrawable, cl[i], IconCell, col[ColBG], ch / 4, y + (ch - iconsz[IconCell]) / 2);
+			cellDC.x = cellDC.w;
+			cellDC.w = cellWidth - cellDC.x;
+			drawCells(cellDC.celldrawable, cl[i]->name, col, False);
+		}
+	XMoveResizeWindow(dpy, m->cellwin, m->wx + (m->ww - (int)cellWidth) / 2,
+	                  m->wy + (m->wh - n * ch) / 2, cellWidth, n * ch);
+	XMapRaised(dpy, m->cellwin);
+	XCopyArea(dpy, cellDC.celldrawable, m->cellwin, cellDC.gc, 0, 0, cellWidth, n * ch, 0, 0);
+}
 
-    return icon_w;
+/* cell i of the switcher in its normal or selected colours: one copy */
+void
+showcell(Monitor *m, int n, int i, Bool sel) {
+	XCopyArea(dpy, cellDC.celldrawable, m->cellwin, cellDC.gc,
+	          0, ((sel ? n : 0) + i) * cellDC.h, cellWidth, cellDC.h, 0, i * cellDC.h);
 }
 
-Pixmap
-getWindowIcon (Client *c) {
-	XWMHints *wmh;
-    Pixmap pxmp = NULL;
-
-	if(wmh = XGetWMHints(dpy, c->win)) {
-        fprintf(stderr, "in getWinIcon: wmh is not null for %s :)\n ", c->name);
-        pxmp = wmh->icon_pixmap;
-        if (!pxmp)
-            fprintf(stderr, "in getWinIcon: %s pixmap is NULL :((((\n", c->name);
-		/*if(wmh->flags & InputHint)*/
-			/*c->neverfocus = !wmh->input;*/
-		/*else*/
-			/*c->neverfocus = False;*/
-		XFree(wmh);
+/* decodes c's icon once for every size in iconsz[], premultiplied, see
+ * icon.c.  The slots stay NULL when c has no usable icon; iconvalid goes
+ * back to False when the client changes it, see propertynotify(). */
+void
+loadicon(Client *c) {
+	unsigned long n, extra, *p = NULL;
+	const unsigned long *img;
+	unsigned char *data = NULL;
+	unsigned int *buf;
+	int i, total, format;
+	Atom type;
+
+	free(c->icon[0]);
+	memset(c->icon, 0, sizeof c->icon);
+	c->iconvalid = True;
+	if(DefaultVisual(dpy, screen)->class != TrueColor)
+		return;
+	if(XGetWindowProperty(dpy, c->win, netatom[NetWMIcon], 0, LONG_MAX, False, XA_CARDINAL,
+	                      &type, &format, &n, &extra, &data) == Success && data) {
+		if(type == XA_CARDINAL && format == 32)
+			p = (unsigned long *)data; /* format 32 comes as longs */
+		else
+			XFree(data);
 	}
+	if(!p && !(p = hinticon(c, &n)))
+		return;
+	if(iconpick(p, n, 1)) {
+		for(total = 0, i = 0; i < IconLast; i++)
+			total += iconsz[i] * iconsz[i];
+		if(!(buf = malloc(total * sizeof(unsigned int))))
+			die("fatal: could not malloc() %u bytes\n", total * sizeof(unsigned int));
+		for(i = 0; i < IconLast; buf += iconsz[i] * iconsz[i], i++) {
+			img = iconpick(p, n, iconsz[i]);
+			iconscale(img + 2, img[0], img[1], buf, iconsz[i]);
+			c->icon[i] = buf;
+		}
+	}
+	if((unsigned char *)p == data)
+		XFree(data);
+	else
+		free(p);
+}
 
-    return pxmp;
+/* composites c's icon for slot over the background pixel bg at x, y in d;
+ * False when c has none */
+Bool
+drawicon(Drawable d, Client *c, int slot, unsigned long bg, int x, int y) {
+	static unsigned int buf[ICONCELL * ICONCELL];
+	Visual *v = DefaultVisual(dpy, screen);
+	int i, sz = iconsz[slot];
+
+	if(!c->iconvalid)
+		loadicon(c);
+	if(!c->icon[slot])
+		return False;
+	if(!iconimg) {
+		if(!(iconimg = XCreateImage(dpy, v, DefaultDepth(dpy, screen), ZPixmap, 0, NULL,
+		                            ICONCELL, ICONCELL, 32, 0)))
+			return False;
+		if(!(iconimg->data = malloc(ICONCELL * iconimg->bytes_per_line)))
+			die("fatal: could not malloc() %u bytes\n", ICONCELL * iconimg->bytes_per_line);
+	}
+	iconblend(c->icon[slot], sz * sz, pixelchannel(v->red_mask, bg) << 16
+	          | pixelchannel(v->green_mask, bg) << 8 | pixelchannel(v->blue_mask, bg), buf);
+	for(i = 0; i < sz * sz; i++)
+		XPutPixel(iconimg, i % sz, i / sz, channelpixel(v->red_mask, buf[i] >> 16 & 0xff)
+		          | channelpixel(v->green_mask, buf[i] >> 8 & 0xff) | channelpixel(v->blue_mask, buf[i] & 0xff));
+	XPutImage(dpy, d, dc.gc, iconimg, 0, 0, x, y, sz, sz);
+	return True;
 }
 
-void altTab() {
-    Monitor *prevMon = selmon;
-    Client *clientToJumpTo;
+/* lowest bit of mask in *shift, and how many bits wide it is */
+int
+maskbits(unsigned long mask, int *shift) {
+	int bits;
 
-    if ((clientToJumpTo = clt[selclt^1]) != selmon->sel && clientToJumpTo) {
-        selclt ^= 1;
+	for(*shift = 0; *shift < LONGBITS && !(mask >> *shift & 1); (*shift)++);
+	for(bits = 0; *shift + bits < LONGBITS && mask >> (*shift + bits) & 1; bits++);
+	return bits;
+}
 
-        focus(clientToJumpTo);
-        restack(selmon);
-        if (selmon != prevMon && !(mouse_follows_focus || !transfer_pointer)) {
-            transferPointerToNextMon(prevMon);
-        }
-    } else if ((clientToJumpTo = clt[selclt]) != selmon->sel && clientToJumpTo) {
-        // this state is if stack was moved via focusstackwithoutraising
-        focus(clientToJumpTo);
-        restack(selmon);
-    }
+/* the 0-255 channel value v where mask puts it in a TrueColor pixel */
+unsigned long
+channelpixel(unsigned long mask, unsigned long v) {
+	int shift, bits = maskbits(mask, &shift);
 
-    return;
+	if(!bits)
+		return 0;
+	return (bits >= 8 ? v << (bits - 8) : v >> (8 - bits)) << shift;
+}
+
+/* and back, from a pixel to 0-255 */
+unsigned int
+pixelchannel(unsigned long mask, unsigned long px) {
+	int shift, bits = maskbits(mask, &shift);
+
+	if(!bits)
+		return 0;
+	px = (px & mask) >> shift;
+	return bits >= 8 ? px >> (bits - 8) : px * 255 / ((1UL << bits) - 1);
+}
+
+/* c's WM_HINTS icon pixmap and mask as a one image _NET_WM_ICON list of
+ * *n longs, for clients that set nothing else; bitmaps take the bar colours */
+unsigned long *
+hinticon(Client *c, unsigned long *n) {
+	Visual *v = DefaultVisual(dpy, screen);
+	XWMHints *wmh;
+	XImage *src = NULL, *smsk = NULL;
+	Window r;
+	int x, y;
+	unsigned int w, h, bw, depth;
+	unsigned long px, *p;
+
+	if(!(wmh = XGetWMHints(dpy, c->win)))
+		return NULL;
+	/* the pixmaps belong to the client and may be gone or bogus */
+	XSetErrorHandler(xerrordummy);
+	if(wmh->flags & IconPixmapHint
+	&& XGetGeometry(dpy, wmh->icon_pixmap, &r, &x, &y, &w, &h, &bw, &depth)
+	&& w <= ICONMAX && h <= ICONMAX
+	&& (depth == 1 || depth == DefaultDepth(dpy, screen))
+	&& (src = XGetImage(dpy, wmh->icon_pixmap, 0, 0, w, h, AllPlanes, ZPixmap))
+	&& wmh->flags & IconMaskHint)
+		smsk = XGetImage(dpy, wmh->icon_mask, 0, 0, w, h, 1, ZPixmap);
+	xsync();
+	XSetErrorHandler(xerror);
+	XFree(wmh);
+	if(!src)
+		return NULL;
+	*n = 2 + w * h;
+	if(!(p = malloc(*n * sizeof(unsigned long))))
+		die("fatal: could not malloc() %u bytes\n", *n * sizeof(unsigned long));
+	p[0] = w;
+	p[1] = h;
+	for(y = 0; y < h; y++)
+		for(x = 0; x < w; x++) {
+			px = XGetPixel(src, x, y);
+			if(depth == 1)
+				px = dc.colors[0][px ? ColFG : ColBG];
+			p[2 + y * w + x] = pixelchannel(v->red_mask, px) << 16 | pixelchannel(v->green_mask, px) << 8
+			                   | pixelchannel(v->blue_mask, px);
+			if(smsk ? XGetPixel(smsk, x, y) : depth != 1 || XGetPixel(src, x, y))
+				p[2 + y * w + x] |= 0xffUL << 24;
+		}
+	XDestroyImage(src);
+	if(smsk)
+		XDestroyImage(smsk);
+	return p;
 }
 
 void hist_fwd(void) {
@@ -4558,421 +5984,11 @@ void tab_back(void) {
     return;
 }
 
-void altTab_2() {
-   fprintf(stderr, "\nsending mod-alt-c-s-ü:\n\n");
-
-
-    /*writeToClipBoard("leeeeelbawks");*/
-
-    /*sendKeyEvent(XK_F7, ControlMask|AltMask|ShiftMask, KeyPress);*/
-    sendKeyEvent(XK_f, Mod4Mask, KeyPress);
-    return;
-
-
-
-    /*XAllowEvents(dpy, AsyncKeyboard, (*(XEvent*)arg->v).xkey.time);*/
-    /*XAllowEvents(dpy, ReplayKeyboard, (*(XEvent*)arg->v).xkey.time);*/
-    /*XFlush(dpy); // has to go with replaykeyboard!!!*/
-
-
-
-
-   XEvent ev;
-   KeySym keySym;
-   int keyMod;
-   /*KeySym tabKey = XKeysymToKeycode(dpy, XK_Tab);*/
-   /*KeySym altKey = XKeysymToKeycode(dpy, XK_Alt_L);*/
-   /*KeyCode tabKey = XKeysymToKeycode(dpy, XK_Tab);*/
-   const KeyCode altKeyCode = XKeysymToKeycode(dpy, XK_Alt_L);
-   const KeyCode tabKeyCode = XKeysymToKeycode(dpy, XK_Tab);
-   fprintf(stderr, "\nstart of altTab function\n\n");
-
-    if ( !selmon->cellwin ) {
-        selmon->cellwin = XCreateSimpleWindow(dpy, root, 1, 1, 1, 1, 0, 0, dc.colors[0][ColBG]);
-    }
-
-                        // Prolly bad idea
-                        /*XGrabKey(dpy, AnyKey, AnyModifier, root,*/
-						 /*True, GrabModeAsync, GrabModeAsync);*/
-    /*if(XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync,*/
-        /*None, cursor[CurMove], CurrentTime) != GrabSuccess)*/
-        /*return;*/
-
-    /*if(XGrabKeyboard(dpy, root, False, */
- /*XGrabKey( dpy, AnyKey, AnyModifier, root, False, GrabModeAsync, GrabModeAsync);*/
-                /*fprintf(stderr, "could not grab \n");*/
-
-					/*XGrabKey(dpy, altKeyCode, AnyModifier, root,*/
-						 /*True, GrabModeAsync, GrabModeAsync);*/
-                    // TODO:! (tries same grabber as in grabkeys(), ie the one confirmed to work)
-                    // prolly doesn't work though since already-tried 'anyModifier'  includes not modifiers)
-    /*return;*/
-/*}*/
-
-
-    // need to call first time outside of the loop:
-    updateAndDrawAltTab(selmon);
-
-
-    /*XUngrabKey(dpy, tabKeyCode, 0, root);*/
-    /*XUngrabKey(dpy, tabKeyCode, AltMask, root);*/
-    /*[>XUngrabKey(dpy, AnyKey, AnyModifier, root);<]*/
-
-    /*XGrabKey(dpy, altKeyCode, 0, root, True, GrabModeAsync, GrabModeAsync);*/
-    /*XGrabKey(dpy, tabKeyCode, AnyModifier, root, True, GrabModeAsync, GrabModeAsync);*/
-
-    int c = 0; // TODO deleteme
-    do {
-        fprintf(stderr, "new cycle of do-loop.\n");
-        /*XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);*/
-        /*XMaskEvent(dpy, AltMask|Mod1Mask|ExposureMask|SubstructureRedirectMask|KeyPressMask|KeyReleaseMask, &ev);*/
-        XMaskEvent(dpy, KeyPressMask|KeyReleaseMask, &ev);
-
-        keySym = XKeycodeToKeysym(dpy, ev.xkey.keycode, 0);
-        keyMod = ev.xkey.state;
-
-        fprintf(stderr, "detected key: %d\n", keySym);
-        switch (ev.type) {
-            /*case ConfigureRequest:*/
-            /*case Expose:*/
-            /*[>case MotionNotify: // TODO: do we want to pass this one?<]*/
-            /*case MapRequest:*/
-                /*handler[ev.type](&ev);*/
-                /*break;*/
-            case KeyPress:
-                fprintf(stderr, "keypress event detected\n");
-                //TODO siia loogika?
-                if ( keySym == XK_Tab ) {
-                    fprintf(stderr, "keypress, tab, launching updateAndDrawAltTab...\n");
-                    updateAndDrawAltTab(selmon);
-                    fprintf(stderr, "... exited updateAndDrawAltTab\n");
-                }
-                break;
-            // TODO: KeyRelease is only for debugging purposes:
-            case KeyRelease:
-                fprintf(stderr, " keyrelease event detected\n");
-                if ( keySym == XK_Alt_L ) {
-                    fprintf(stderr, "keyrelease, alt\n");
-                }
-
-                if(keySym == XK_Tab
-                        && CLEANMASK(AltMask) == CLEANMASK(keyMod) ){
-                    fprintf(stderr, "     @upddate: altTab release detected!!!!!! \n");
-                }
-
-
-                /*if ( keySym == XK_Alt_L ) return;*/
-                break;
-        }
-
-        // TODO: just-in-case counter; deleteme:
-        c++;
-        if (c > 9) {
-            fprintf(stderr, "     exiting because of safety counter count %d\n ", c);
-            break;
-        }
-    } while(ev.type != KeyRelease || keySym != XK_Alt_L ); // until alt is released
-    /*} while(ev.type != KeyRelease || ( keySym != XK_Alt_L && !(keySym & Mod1Mask) )); // until alt is released*/
-
-   fprintf(stderr, "exited from the loop!\n");
-    /*XUngrabKey(dpy, AnyKey, AnyModifier, root);*/
-
-
-    /*XUngrabKey(dpy, altKeyCode, 0, root);*/
-    /*XGrabKey(dpy, tabKeyCode, AltMask, root,*/
-            /*True, GrabModeAsync, GrabModeAsync);*/
-
-
-
-
-    /*grabkeys();*/
-
-
-
-
-
-    /*XUngrabKey(dpy, tabKeyCode, Mod1Mask, root);*/
-
-    // Finally, hide away the window:
-   /*XLowerWindow( dpy, m->cellwin);*/
-   // OR???:
-   XMoveWindow(dpy, selmon->cellwin, cellWidth * -2, 0); // hide
-   // TODO: is xsync needed here?:
-   XSync(dpy, False);
-}
-
-void
-updateAndDrawAltTab(Monitor *m) {
-   int MAX_CLIENTS = 10; //TODO move out into config
-   Pixmap clientIcon;
-   Window clientIconWin;
-   unsigned long *col;
-   Client *c;
-   int i;
-   int itag = -1;
-   char view_info[50];
-   int view_info_w = 0;
-   int sorted_label_widths[MAX_CLIENTS];
-   int tot_width;
-   int maxsize = bh;
-   int nrOfCells;
-   int singleCellHeight = cellDC.font.height; //TODO; kui mingieid vahealasid teha, siis siit alusta?
-   int totalCellHeight = 0;
-   int ch; // TODO needs to be calculated
-   int cwy, cwx; // cell window origin
-
-
-   /*if ( !m->cellwin )*/
-       /*m->cellwin = XCreateSimpleWindow(dpy, root, 100, 100, 100, 100, 0, 0, dc.colors[0][ColBG]);*/
-
-    //TODO: move this out? make const? what is it for lel?
-	XSetWindowAttributes wa = {
-		.override_redirect = True,
-		.background_pixmap = ParentRelative,
-		.event_mask = ButtonPressMask|ExposureMask
-	};
-
-   // Calculate total cell block height
-   for( i = 0, c = m->clients; c; c = c->next, i++){
-     if(!ISVISIBLE(c) || c->isInSkipList) continue;
-
-     totalCellHeight += singleCellHeight;
-     if(i >= MAX_CLIENTS) break;
-   }
-   if(!totalCellHeight) return;
-   /*fprintf(stderr, "  single cell height: %d\n", singleCellHeight);*/
-   /*fprintf(stderr, "  cellwin total height: %d\n", totalCellHeight);*/
-
-    /*if(cellDC.celldrawable != 0)*/
-        /*XFreePixmap(dpy, cellDC.celldrawable);*/
-	/*cellDC.celldrawable = XCreatePixmap(dpy, root, cellWidth, totalCellHeight, DefaultDepth(dpy, screen));*/
-
-   //TODO: better it
-   /*if (!totalCellHeight) return;*/
-   /*totalCellHeight=1;*/
-   /*totalCellHeight = (totalCellHeight == 0) ? 50 : totalCellHeight;*/
-
-   cwy = m->wh/2 - totalCellHeight/2;
-   cwx = m->wx + m->ww/2 - cellWidth/2;
-
-
-   /*dc.x = m->wx+300;*/
-   /*dc.y = cy;*/
-   cellDC.x = 0;
-   cellDC.y = 0;
-   cellDC.w = cellWidth;
-
-   //view_info: indicate the tag which is displayed in the view:
-   /*
-    *for(i = 0; i < LENGTH(tags); ++i){
-    *  if((selmon->tagset[selmon->seltags] >> i) & 1) {
-    *    if(itag >=0){ //more than one tag selected
-    *      itag = -1;
-    *      break;
-    *    }
-    *    itag = i;
-    *  }
-    *}
-    *if(0 <= itag  && itag < LENGTH(tags)){
-    *  snprintf(view_info, sizeof view_info, "[%s]", tags[itag]);
-    *} else {
-    *  strncpy(view_info, "[...]", sizeof view_info);
-    *}
-    */
-   /*view_info[sizeof(view_info) - 1 ] = 0;*/
-   /*view_info_w = TEXTW(view_info);*/
-   /*tot_width = view_info_w;*/
-
-   /* Calculates number of labels and their width */
-   /*for( i = 0, c = m->clients; c; c = c->next, i++){*/
-     /*if(!ISVISIBLE(c)) continue;*/
-     /*totalCellHeight += singleCellHeight;*/
-     /*if(i >= MAX_CLIENTS) break;*/
-   /*}*/
-
-// TODO: do we need this?
-   /*if(tot_width > m->ww){ //not enough space to display the labels, they need to be truncated*/
-     /*memcpy(sorted_label_widths, m->tab_widths, sizeof(int) * m->ntabs);*/
-     /*qsort(sorted_label_widths, m->ntabs, sizeof(int), cmpint);*/
-     /*tot_width = view_info_w;*/
-     /*for(i = 0; i < m->ntabs; ++i){*/
-       /*if(tot_width + (m->ntabs - i) * sorted_label_widths[i] > m->ww)*/
-         /*break;*/
-       /*tot_width += sorted_label_widths[i];*/
-     /*}*/
-     /*maxsize = (m->ww - tot_width) / (m->ntabs - i);*/
-   /*} else{*/
-     /*maxsize = m->ww;*/
-   /*}*/
-
-   /*for( i = 0, c = m->clients; c; c = c->next ) {*/
-        /*fprintf(stderr, "  !!! trying to fetx clientIconWIN___ for %s...\n: ", c->name);*/
-        /*clientIconWin = getWindowIconWindow(c); // TODO*/
-
-        /*if (clientIconWin) {*/
-            /*fprintf(stderr, "  !!! found clientIconWIN___ for %s\n: ", c->name);*/
-            /*break;*/
-        /*}*/
-    /*}*/
-   for( i = 0, c = m->clients; c; c = c->next ) {
-        fprintf(stderr, "  !!! trying to fetx clientIcon___ for %s...\n: ", c->name);
-        clientIcon= getWindowIcon(c); // TODO
-
-        if (clientIcon) {
-            fprintf(stderr, "  !!! found clientIcon___ for %s\n: ", c->name);
-            break;
-        }
-    }
-
-   for( i = 0, c = m->clients; c; c = c->next ) {
-     if(!ISVISIBLE(c) || c->isInSkipList) continue;
-     if(i >= MAX_CLIENTS) break;
-
-        clientIcon = getWindowIcon(c); // TODO
-        /*clientIconWin = getWindowIconWindow(c); // TODO*/
-
-        /*if (clientIconWin) {*/
-            /*fprintf(stderr, "  !!! found clientIconWIN___ for %s\n: ", c->name);*/
-            /*break;*/
-        /*}*/
-        if (clientIcon) {
-            fprintf(stderr, "  !!! found clientIcon___ for %s\n: ", c->name);
-            break;
-        }
-
-    // coloring:
-     if( m->nmasters[m->curtag] > 1 && i < m->nmasters[m->curtag]) // more than one master client
-        // color masters differently:
-        col = (c == m->sel) ? cellDC.colors[16] : cellDC.colors[15];
-     else // single master client
-        col = (c == m->sel) ? cellDC.colors[13] : cellDC.colors[12];
-        /*
-         *col = dc.colors[ (m->tagset[m->seltags] & 1 << i) ?
-         *1 : (urg & 1 << i ? 2:0) ]
-         */
-
-
-
-
-
-     /*drawCells(cellDC.celldrawable, c->name, col, 0);*/
-
-
-
-     /*drawTabbarTextDELETEME(cellDC.celldrawable, c->name, col, 0);*/
-     /*drawTabbarText(dc.celldrawable, c->name, col, 0);*/
-
-     // XPutImage??
-
-     cellDC.y += singleCellHeight;
-     i++; // may not be in loop control!
-   }
-
-
-
-
-
-   /*[> cleans interspace between window names and current viewed tag label <]*/
-   /*dc.w = m->ww - view_info_w - dc.x;*/
-   /*drawCells(dc.tabdrawable, NULL, dc.colors[0], 0);*/
-
-   /*[> view info <]*/
-   /*dc.x += dc.w;*/
-   /*dc.w = view_info_w;*/
-   /*drawCells(dc.tabdrawable, view_info, dc.colors[0], 0);*/
-
-   // first clean up:
-   // TODO: moveresize instead?
-   /*if ( m->cellwin ) {*/
-	/*XUnmapWindow(dpy, m->cellwin);*/
-	/*XDestroyWindow(dpy, m->cellwin);*/
-   /*}*/
-
-        // first create the xwindow; TODO: does it really need to be re-created errytime?
-        // perhaps hide it and expose later if re-used?
-        // TODO2: cellHeight here is the total, and should already be calculated by this moment;
-        // TODO3: cellwin Window struct alt siia kohalikku tuua? ei näe pointi
-        // monitoriga sidumiseks;
-		/*m->cellwin = XCreateWindow(dpy, root, cwx, cwy, cellWidth, totalCellHeight, 10, DefaultDepth(dpy, screen),*/
-					  /*CopyFromParent, DefaultVisual(dpy, screen),*/
-					  /*CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);*/
-
-   /*if ( !m->cellwin )*/
-       /*m->cellwin = XCreateSimpleWindow(dpy, root, cwx, cwy, cellWidth, totalCellHeight, 0, 0, dc.colors[0][ColBG]);*/
-    XMoveResizeWindow(dpy, m->cellwin, cwx, cwy, cellWidth, totalCellHeight);
-    XDefineCursor(dpy, m->cellwin, cursor[CurNormal]);
-
-
-
-
-    // this one is in works:
-   /*XCopyArea(dpy, cellDC.celldrawable, m->cellwin, cellDC.gc, 0, 0, cellWidth, totalCellHeight, 0, 0);*/
-
-   if(!clientIcon) {
-        fprintf(stderr, "no clienticon for %s\n", c->name);
-        XMapRaised(dpy, m->cellwin);
-        XSync(dpy, False);
-       return;
-    }
-   /*if(!clientIconWin) {*/
-        /*fprintf(stderr, "no clienticonWIN for %s, returning\n", c->name);*/
-        /*XMapRaised(dpy, m->cellwin);*/
-        /*XSync(dpy, False);*/
-        /*return;*/
-    /*}*/
-
-
-
-
-   /*int dummy_i;*/
-    unsigned int px_w, px_h, dummy_i;
-   Window icon_w, dummy_w;
-   // find the pixmap dimensions:
-   XGetGeometry(dpy, clientIcon, &dummy_w, &dummy_i, &dummy_i, &px_w, &px_h, &dummy_i, &dummy_i );
-    fprintf(stderr, "pixmap w: %d, h: %d\n", px_w, px_h);
-
-    // create new window with the same dimensions as is the pixmap (so it could be resized)
-    icon_w = XCreateSimpleWindow(dpy, root, 0, 0, px_w, px_h, 0, 0, dc.colors[0][ColBG]);
-
-    // sanity check on newly created win:
-    /*XGetGeometry(dpy, icon_w, &dummy_w, &dummy_i, &dummy_i, &px_w, &px_h, &dummy_ii, &dummy_ii );*/
-    /*fprintf(stderr, "sanity: new win w: %d, h: %d\n",px_w , px_h);*/
-
-
-	XMapWindow(dpy, icon_w);
-    /*XMoveResizeWindow(dpy, icon_w, 0, 0, 200, 200);*/ //TODO: if you resize before copying in the pixmap, then it's OK;
-   XMapRaised(dpy, icon_w); // ! TODO: for some reason win has to be raised before xCopyArea.
-    // copy pixmap to new win:
-   XCopyArea(dpy, clientIcon, icon_w, cellDC.gc, 0, 0, px_w, px_h, 0, 0);
-
-   // resize:
-   // !!!!!!!!!!! TODO: this fucks shit up:
-    /*XMoveResizeWindow(dpy, icon_w, 0, 0, 200, 200);*/
-    /*XMoveResizeWindow(dpy, icon_w, 0, 0, px_w-1, px_h-1);*/
-    XResizeWindow(dpy, icon_w, px_w+1, px_h+1);
-
-
-   //TODO: is this raising nexessary?:
-   XMapRaised(dpy, icon_w);
-
-   /*XCopyArea(dpy, clientIcon, m->cellwin, cellDC.gc, 0, 0, 70, 70, 0, 0);*/
-   XCopyArea(dpy, icon_w, m->cellwin, cellDC.gc, 0, 0, 50, 50, 0, 0);
-
-    // !:
-   /*XCopyArea(dpy, icon_w, m->cellwin, cellDC.gc, 0, 0, 70, 70, 0, 0);*/
-
-
-
-   XMapRaised(dpy, m->cellwin);
-   XSync(dpy, False);
-   XFlush(dpy);
-
-}
-
 void
 drawCells(Drawable drawable, const char *text, unsigned long col[ColLast], Bool pad) {
 	char buf[256];
 	int i, x, y, h, len, olen;
+	unsigned int fit;
     const short lenOfTrailingWhitespace = 4;
     const short lenOfTrailingSymbols = 3;
     const short lenOfTruncationDots = 3;
@@ -4989,7 +6005,8 @@ drawCells(Drawable drawable, const char *text, unsigned long col[ColLast], Bool
     y = cellDC.y + ((cellDC.h + cellDC.font.ascent - cellDC.font.descent) / 2);
 	x = cellDC.x + (h / 2);
 	/* shorten text if necessary */
-	for(len = MIN(olen, sizeof buf); len && textnw(text, len) > cellDC.w - h; len--);
+	textfit(&cellDC.font, text, MIN(olen, sizeof buf), cellDC.w - h, &fit);
+	len = fit;
 	if(!len)
 		return;
 	memcpy(buf, text, len);
@@ -5107,31 +6124,6 @@ char* fgetsr(char* buf, int n, FILE* binaryStream) {
   return buf;
 }
 
-pid_t getProcessId(const char processName[]) {
-    int MAX_COMMAND_NAME_LEN = 80;
-    const char command_head[] = "pidof ";
-    char *cmd_string[MAX_COMMAND_NAME_LEN];
-    int LEN = 10;
-    char pid_line[LEN];
-
-    if (MAX_COMMAND_NAME_LEN - strlen(processName) - strlen(command_head) < 0) {
-        // string wouldn't fit
-        fprintf(stderr, "failed to get the pid for \'%s\', since it's name doesn't fit into the command_string array. Make the array larger.\n", processName);
-        return 0;
-    }
-
-    strcpy(cmd_string, command_head);
-    strcat(cmd_string, processName);
-    FILE *cmd = popen(cmd_string, "r");
-    /*FILE *cmd = popen("pidof synergys", "r");*/
-
-    fgets(pid_line, sizeof(pid_line), cmd);
-    pid_t pid = strtoul(pid_line, NULL, 10);
-
-    return pid;
-}
-
-
 // TODO name and return type:
 int getLastOccurrenceInLog(char line[]) {
   FILE* f;
@@ -0,0 +1,124 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Clients, monitors and layouts, shared by dwm.c and the code it pulls in
+ * (layout.c, bstack.c, gaplessgrid.c).  Kept apart so the layout code can
+ * be built without the rest of dwm, see bench/.
+ */
+
+/* macros */
+#define ISVISIBLE(C)            ((C->tags & C->mon->tagset[C->mon->seltags]))
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+#define MAX(A, B)               ((A) > (B) ? (A) : (B))
+#define MIN(A, B)               ((A) < (B) ? (A) : (B))
+#define WIDTH(X)                ((X)->w + 2 * (X)->bw)
+#define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
+#define MAXTABS 50
+
+/* enums */
+enum { ClassSkip = 1<<0, ClassIdea = 1<<1 }; /* class flags, see classflags() */
+enum { ListTiled, ListFocus, ListFocusTiled, ListFocusFloat, ListLast }; /* Monitor.vis, see updatevis() */
+enum { IconBar, IconTab, IconCell, IconLast }; /* Client.icon sizes */
+
+/* types */
+typedef struct Monitor Monitor;
+typedef struct Client Client;
+struct Client {
+	/* hot: read by ISVISIBLE, the layouts and every list walk */
+	Client *next;
+	Client *snext;
+	Monitor *mon;
+	Window win;
+	unsigned int tags;
+	int x, y, w, h;
+	int bw, oldbw; // bar geomentry
+	int cbw;                /* border width the window was last configured with */
+	unsigned int pending;   /* CW* fields placed but not yet configured */
+	Bool hidden;            /* moved off screen by showhide() */
+	Bool isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, iscentred;
+	unsigned int classflags; /* Class* bits of className */
+	float cfact;
+	int vispos[ListLast];   /* members of each Monitor.vis list before this client */
+	unsigned int visin;     /* bit l set: in Monitor.vis[l] */
+	/* cold: titles, classes, size hints and saved geometry */
+	char *name;             /* see setname() */
+	unsigned int namesize;  /* bytes allocated for name */
+	unsigned int namehash;  /* of name, set with it */
+	const char *className;  /* first WM_CLASS string, interned */
+	const char *resClass;   /* second WM_CLASS string, interned */
+	Client *cnext, *cprev;  /* same resClass, most recently focused first */
+	Monitor *home;          /* parked monitor it was moved off, see parkmon() */
+	float mina, maxa;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	int sfx, sfy, sfw, sfh; /* stored float geometry, used on mode revert */
+	int oldx, oldy, oldw, oldh;
+	Pixmap tabpm;           /* rendered tab, valid for the key below */
+	unsigned int tabhash;
+	unsigned long *tabcol;
+	int tabw;
+	unsigned int *icon[IconLast]; /* premultiplied, one per size; icon[0] owns them */
+	Bool iconvalid;         /* icon[] decoded, see loadicon() */
+	Pixmap iconhint;        /* WM_HINTS icon_pixmap when it was decoded */
+};
+
+typedef struct {
+	const char *symbol;
+	void (*arrange)(Monitor *);
+} Layout;
+
+struct Monitor {
+	char ltsymbol[16];
+	int num;
+	int by;               /* bar y location*/
+	int ty;               /* tab bar y location */
+	int mx, my, mw, mh;   /* screen size, as in total */
+	int wx, wy, ww, wh;   /* window area, ie where windows can be drawn  */
+	unsigned int seltags;
+	unsigned int sellt; // TODO: selected layout? saab olla 0 või 1
+	unsigned int tagset[2];
+	Bool showbar;
+	Bool showtab;
+	Bool topbar;
+	Bool toptab;
+	Client *clients;
+	Client *sel; // != focused!
+	Client *stack;
+	Monitor *next;
+	Window barwin;
+	Window tabwin;
+	Window cellwin; // alt+tab window
+	Window crosswin;      /* InputOnly, under all clients, see crossmon() */
+	int ntabs;
+	int tab_widths[MAXTABS]; //TODO remove, as now all the tabs are of uniform width; // TODO: will be deprecated
+	const Layout *lt[2]; // TODO: contains current and previous layout???
+    // per monitor alttab client stack; we don't want per monitor, do we?
+	/*const Client *clt[2]; // TODO: contains current and previous selected clients???*/
+    /*unsigned int selclt;*/
+	int curtag; // TODO: shows which *view* we're currently in? (yup, should be that)
+	int prevtag;
+	const Layout **lts;
+	double *mfacts;
+	int *nmasters;
+	unsigned int dirty;   /* bar regions to repaint on the next flushbars() */
+	int titlex, titlew;   /* title span as last painted */
+	Client **vis[ListLast]; /* visible clients in list order, one array per filter */
+	int nvis[ListLast];
+	int vissize;          /* room in each vis array */
+	Bool visdirty;        /* vis needs rebuilding, see updatevis() */
+	Atom output;          /* XRandR monitor name, None without XRANDR */
+	Bool resized;         /* geometry changed by updategeom(), see updatemons() */
+};
+
+/* layout.c */
+static void applyplan(Monitor *m);
+static Bool applysizehints(Client *c, int *x, int *y, int *w, int *h, Bool interact);
+static void arrange(Monitor *m);
+static void arrangemon(Monitor *m);
+static void configure(Client *c);
+static void deck(Monitor *m);
+static void monocle(Monitor *m);
+static void place(Client *c, int x, int y, int w, int h);
+static void resize(Client *c, int x, int y, int w, int h, Bool interact);
+static void resizeclient(Client *c, int x, int y, int w, int h);
+static void showhide(Client *c);
+static void tile(Monitor *);
+static void updatevis(Monitor *m);
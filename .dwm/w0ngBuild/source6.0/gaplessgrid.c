@@ -3,8 +3,7 @@ gaplessgrid(Monitor *m) {
 	unsigned int n, cols, rows, cn, rn, i, cx, cy, cw, ch;
 	Client *c;
 
-	for(n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next))
-		n++;
+	n = m->nvis[ListTiled];
 	if(n == 0)
 		return;
 
@@ -20,20 +19,19 @@ gaplessgrid(Monitor *m) {
 	cw = cols ? m->ww / cols : m->ww;
 	cn = 0; /* current column number */
 	rn = 0; /* current row number */
-	for(i = 0, c = nexttiled(m->clients); c; i++, c = nexttiled(c->next)) {
+	for(i = 0; i < n; i++) {
+		c = m->vis[ListTiled][i];
 		if(n == 1) {
 			if (c->bw) {
 				/* remove border when only one window is on the current tag */
 				c->oldbw = c->bw;
 				c->bw = 0;
-				/*r = 1;*/ // TODO
 			}
 		}
 		else if(!c->bw && c->oldbw) {
 			/* restore border when more than one window is displayed */
 			c->bw = c->oldbw;
 			c->oldbw = 0;
-            /*r = 1;*/ // TODO
 		}
 
 		if(i/rows + 1 > cols - n%cols)
@@ -41,7 +39,7 @@ gaplessgrid(Monitor *m) {
 		ch = rows ? m->wh / rows : m->wh;
 		cx = m->wx + cn*cw;
 		cy = m->wy + rn*ch;
-		resize(c, cx, cy, cw - 2 * c->bw, ch - 2 * c->bw, False);
+		place(c, cx, cy, cw - 2 * c->bw, ch - 2 * c->bw);
 		rn++;
 		if(rn >= rows) {
 			rn = 0;
@@ -0,0 +1,163 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Icon scaling.  _NET_WM_ICON holds any number of images, each as width,
+ * height and width * height ARGB pixels, one per long.  iconpick() finds
+ * the one that suits a cell, iconscale() premultiplies it and box filters
+ * it down to the cell once, and iconblend() lays the result over a
+ * background whenever a cached tab or cell is drawn again.  Included by
+ * dwm.c; no X in here, see bench/iconbench.c.
+ */
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define ICONMAX                 1024  /* larger images are skipped; keeps box sums in 32 bits */
+#define ICONCELL                128   /* largest cell iconscale() fills */
+#define DIV255(V)               (((V) + 128 + (((V) + 128) >> 8)) >> 8)  /* rounded, V <= 255 * 255 */
+
+/* the image in a list of n longs that fits a sz cell best: the smallest
+ * one at least that big, else the biggest; NULL if there is none */
+const unsigned long *
+iconpick(const unsigned long *p, unsigned long n, int sz) {
+	const unsigned long *end = p + n, *best = NULL;
+	unsigned long d, bd = 0;
+
+	for(; end - p > 2 && p[0] && p[1] && p[0] <= ICONMAX && p[1] <= ICONMAX
+	    && p[0] * p[1] <= (unsigned long)(end - p - 2); p += 2 + p[0] * p[1]) {
+		d = MAX(p[0], p[1]);
+		if(!best || (bd < (unsigned long)sz ? d > bd : d >= (unsigned long)sz && d < bd)) {
+			best = p;
+			bd = d;
+		}
+	}
+	return best;
+}
+
+static unsigned int
+premul(unsigned long px) {
+	unsigned int a = px >> 24 & 0xff;
+
+	return a << 24 | DIV255((px >> 16 & 0xff) * a) << 16
+	       | DIV255((px >> 8 & 0xff) * a) << 8 | DIV255((px & 0xff) * a);
+}
+
+/* adds the premultiplied pixels of one source row to the sums of the
+ * cells they fall in, col[x] being the cell of pixel x; acc holds four
+ * sums per cell, in the byte order of a pixel (b, g, r, a) */
+#ifdef __SSE2__
+static void
+iconrow(const unsigned long *src, int w, const unsigned char *col, unsigned int *acc) {
+	const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(128);
+	const __m128i rgb = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	const __m128i opaque = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	__m128i v, a, t, sum = zero, *s;
+	int x, cur = col[0];
+
+	/* two pixels a step, channels in 16 bit lanes; the sum of the current
+	 * cell stays in a register until the row moves on to the next one */
+	for(x = 0; x < w; x += 2) {
+		v = _mm_set_epi32(0, 0, x + 1 < w ? (int)src[x + 1] : 0, (int)src[x]);
+		v = _mm_unpacklo_epi8(v, zero);
+		a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		a = _mm_or_si128(_mm_and_si128(a, rgb), opaque);
+		t = _mm_add_epi16(_mm_mullo_epi16(v, a), round);
+		t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+		if(col[x] != cur) {
+			s = (__m128i *)(acc + 4 * cur);
+			_mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), sum));
+			sum = zero;
+			cur = col[x];
+		}
+		sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(t, zero));
+		if(x + 1 == w)
+			break;
+		if(col[x + 1] != cur) {
+			s = (__m128i *)(acc + 4 * cur);
+			_mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), sum));
+			sum = zero;
+			cur = col[x + 1];
+		}
+		sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(t, zero));
+	}
+	s = (__m128i *)(acc + 4 * cur);
+	_mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), sum));
+}
+#else
+static void
+iconrow(const unsigned long *src, int w, const unsigned char *col, unsigned int *acc) {
+	unsigned int p, *s;
+	int x;
+
+	for(x = 0; x < w; x++) {
+		p = premul(src[x]);
+		s = acc + 4 * col[x];
+		s[0] += p & 0xff;
+		s[1] += p >> 8 & 0xff;
+		s[2] += p >> 16 & 0xff;
+		s[3] += p >> 24;
+	}
+}
+#endif /* __SSE2__ */
+
+/* src, a w x h image as iconpick() found it, fitted into the middle of the
+ * sz x sz dst and premultiplied: box filtered when it shrinks, which is
+ * what browsers' 256 pixel icons do, nearest neighbour when it grows */
+void
+iconscale(const unsigned long *src, int w, int h, unsigned int *dst, int sz) {
+	unsigned int acc[4 * ICONCELL], *s;
+	unsigned char col[ICONMAX];
+	int x, y, dx, dy, dw, dh, ox, oy, n, cx[ICONCELL], cy;
+
+	sz = MIN(sz, ICONCELL);
+	memset(dst, 0, sz * sz * sizeof *dst);
+	dw = MAX(1, w * sz / MAX(w, h));
+	dh = MAX(1, h * sz / MAX(w, h));
+	ox = (sz - dw) / 2;
+	oy = (sz - dh) / 2;
+	dst += oy * sz + ox;
+	if(w < dw || h < dh) {
+		for(dy = 0; dy < dh; dy++)
+			for(dx = 0; dx < dw; dx++)
+				dst[dy * sz + dx] = premul(src[dy * h / dh * w + dx * w / dw]);
+		return;
+	}
+	memset(cx, 0, dw * sizeof *cx);
+	for(x = 0; x < w; x++)
+		cx[col[x] = x * dw / w]++;
+	for(y = 0, dy = 0; dy < dh; dy++) {
+		memset(acc, 0, 4 * dw * sizeof *acc);
+		for(cy = 0; y < h && y * dh / h == dy; y++, cy++)
+			iconrow(src + y * w, w, col, acc);
+		for(dx = 0, s = acc; dx < dw; dx++, s += 4) {
+			n = cx[dx] * cy;
+			dst[dy * sz + dx] = (s[3] + n / 2) / n << 24 | (s[2] + n / 2) / n << 16
+			                    | (s[1] + n / 2) / n << 8 | (s[0] + n / 2) / n;
+		}
+	}
+}
+
+/* n premultiplied pixels of icon over the opaque 0xrrggbb bg into out */
+void
+iconblend(const unsigned int *icon, int n, unsigned int bg, unsigned int *out) {
+	int i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(128);
+	const __m128i b = _mm_unpacklo_epi8(_mm_set1_epi32(bg & 0xffffff), zero);
+	const __m128i full = _mm_set1_epi16(255);
+	__m128i v, a, t;
+
+	for(; i + 1 < n; i += 2) {
+		v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(icon + i)), zero);
+		a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		t = _mm_add_epi16(_mm_mullo_epi16(b, _mm_sub_epi16(full, a)), round);
+		t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+		_mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(_mm_add_epi16(v, t), zero));
+	}
+#endif /* __SSE2__ */
+	for(; i < n; i++) {
+		unsigned int a = 255 - (icon[i] >> 24);
+
+		out[i] = icon[i] + (DIV255((bg >> 16 & 0xff) * a) << 16
+		         | DIV255((bg >> 8 & 0xff) * a) << 8 | DIV255((bg & 0xff) * a));
+	}
+}
@@ -0,0 +1,403 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Client geometry: size hints, the built-in layouts and how their result
+ * reaches the X server.  Included by dwm.c; uses dpy, sw, sh, bh, th, mons and
+ * resizehints from there, and calls back into updatebarpos(),
+ * restack() and die().
+ */
+
+/* sends what the layout placed: one request per client whose geometry
+ * or border actually changed, carrying only the changed fields */
+void
+applyplan(Monitor *m) {
+	XWindowChanges wc;
+	Client *c;
+
+	for(c = m->clients; c; c = c->next) {
+		if(!c->pending || c->hidden)
+			continue;
+		wc.x = c->x;
+		wc.y = c->y;
+		wc.width = c->w;
+		wc.height = c->h;
+		wc.border_width = c->cbw = c->bw;
+		XConfigureWindow(dpy, c->win, c->pending, &wc);
+		c->pending = 0;
+		configure(c);
+	}
+}
+
+Bool
+applysizehints(Client *c, int *x, int *y, int *w, int *h, Bool interact) {
+	Bool baseismin;
+	Monitor *m = c->mon;
+
+	/* set minimum possible */
+	*w = MAX(1, *w);
+	*h = MAX(1, *h);
+	if(interact) {
+		if(*x > sw)
+			*x = sw - WIDTH(c);
+		if(*y > sh)
+			*y = sh - HEIGHT(c);
+		if(*x + *w + 2 * c->bw < 0)
+			*x = 0;
+		if(*y + *h + 2 * c->bw < 0)
+			*y = 0;
+	}
+	else {
+		if(*x >= m->wx + m->ww)
+			*x = m->wx + m->ww - WIDTH(c);
+		if(*y >= m->wy + m->wh)
+			*y = m->wy + m->wh - HEIGHT(c);
+		if(*x + *w + 2 * c->bw <= m->wx)
+			*x = m->wx;
+		if(*y + *h + 2 * c->bw <= m->wy)
+			*y = m->wy;
+	}
+	if(*h < bh)
+		*h = bh;
+	if(*w < bh)
+		*w = bh;
+	if(resizehints || c->isfloating || !c->mon->lt[c->mon->sellt]->arrange) {
+		/* see last two sentences in ICCCM 4.1.2.3 */
+		baseismin = c->basew == c->minw && c->baseh == c->minh;
+		if(!baseismin) { /* temporarily remove base dimensions */
+			*w -= c->basew;
+			*h -= c->baseh;
+		}
+		/* adjust for aspect limits */
+		if(c->mina > 0 && c->maxa > 0) {
+			if(c->maxa < (float)*w / *h)
+				*w = *h * c->maxa + 0.5;
+			else if(c->mina < (float)*h / *w)
+				*h = *w * c->mina + 0.5;
+		}
+		if(baseismin) { /* increment calculation requires this */
+			*w -= c->basew;
+			*h -= c->baseh;
+		}
+		/* adjust for increment value */
+		if(c->incw)
+			*w -= *w % c->incw;
+		if(c->inch)
+			*h -= *h % c->inch;
+		/* restore base dimensions */
+		*w = MAX(*w + c->basew, c->minw);
+		*h = MAX(*h + c->baseh, c->minh);
+		if(c->maxw)
+			*w = MIN(*w, c->maxw);
+		if(c->maxh)
+			*h = MIN(*h, c->maxh);
+	}
+	return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
+}
+
+/* callers change tagsets, tags, floating state and list order right
+ * before arranging, so this is where the vis lists are invalidated */
+void
+arrange(Monitor *m) {
+	if(m) {
+		m->visdirty = True;
+		showhide(m->stack);
+	}
+	else for(m = mons; m; m = m->next) {
+		m->visdirty = True;
+		showhide(m->stack);
+	}
+	if(m)
+		arrangemon(m);
+	else for(m = mons; m; m = m->next)
+		arrangemon(m);
+}
+
+void
+arrangemon(Monitor *m) {
+	updatevis(m);
+	updatebarpos(m);
+	XMoveResizeWindow(dpy, m->tabwin, m->wx, m->ty, m->ww, th);
+
+	strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
+	if(m->lt[m->sellt]->arrange) // TODO: kontrollib, kas layoutil on funktsioon olemas? (floatil funktsioon puudub)
+		m->lt[m->sellt]->arrange(m); // siin kutsutakse konkreetset lyt meetodit vist välja?
+	applyplan(m);
+	restack(m);
+}
+
+void
+configure(Client *c) {
+	XConfigureEvent ce;
+
+	ce.type = ConfigureNotify;
+	ce.display = dpy;
+	ce.event = c->win;
+	ce.window = c->win;
+	ce.x = c->x;
+	ce.y = c->y;
+	ce.width = c->w;
+	ce.height = c->h;
+	ce.border_width = c->bw;
+	ce.above = None;
+	ce.override_redirect = False;
+	XSendEvent(dpy, c->win, False, StructureNotifyMask, (XEvent *)&ce);
+}
+
+void
+deck(Monitor *m) {
+	int dn;
+	unsigned int i, n, h, mw, my;
+	Client *c, **t = m->vis[ListTiled];
+	float mfacts = 0, sfacts = 0;
+
+	for(n = 0; n < m->nvis[ListTiled]; n++) {
+		if(n < m->nmasters[m->curtag])
+			mfacts += t[n]->cfact;
+		/*else*/
+			/*sfacts += t[n]->cfact;*/
+    }
+
+	if(n == 0)
+		return;
+
+	dn = n - m->nmasters[m->curtag]; // count of stacked slaves, ie clients in deck
+
+	if(dn > 0) /* override layout symbol */
+		snprintf(m->ltsymbol, sizeof m->ltsymbol, " D %d", dn);
+
+	if(n > m->nmasters[m->curtag])
+		mw = m->nmasters[m->curtag] ? m->ww * m->mfacts[m->curtag] : 0;
+	else
+		mw = m->ww;
+	for(i = my = 0; i < n; i++) {
+		c = t[i];
+        // TODO:
+		/*if(n == 1) {*/
+			/*if (c->bw) {*/
+				/*[> remove border when only one window is on the current tag <]*/
+				/*c->oldbw = c->bw;*/
+				/*c->bw = 0;*/
+				/*r = 1;*/
+			/*}*/
+		/*}*/
+		/*else if(!c->bw && c->oldbw) {*/
+			/*[> restore border when more than one window is displayed <]*/
+			/*c->bw = c->oldbw;*/
+			/*c->oldbw = 0;*/
+			/*r = 1;*/
+		/*}*/
+
+		if(i < m->nmasters[m->curtag]) {
+            h = (m->wh - my) * (c->cfact / mfacts); // oli enne
+			place(c,
+                   m->wx,
+                   m->wy + my,
+                   mw - (2*c->bw),
+                   h - (2*c->bw));
+			/*if(r)*/
+				/*resizeclient(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw));*/
+			my += HEIGHT(c);
+			mfacts -= c->cfact;
+
+            // before:
+			/*h = (m->wh - my) / (MIN(n, m->nmasters[m->curtag]) - i);*/
+			/*resize(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw), False);*/
+            /*
+			 *if(r)
+			 *    resizeclient(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw));
+             */
+			/*my += HEIGHT(c);*/
+		}
+		else
+			place(c, m->wx + mw, m->wy, m->ww - mw - (2*c->bw), m->wh - (2*c->bw));
+            /*
+			 *if(r)
+			 *    resizeclient(c, m->wx + mw, m->wy, m->ww - mw - (2*c->bw), m->wh - (2*c->bw));
+             */
+	}
+}
+
+void
+monocle(Monitor *m) {
+	Client *c;
+	int i;
+
+  for(i = 0; i < m->nvis[ListTiled]; i++) {
+    c = m->vis[ListTiled][i];
+    /* remove border when in monocle layout */
+    if(c->bw) {
+      c->oldbw = c->bw;
+      c->bw = 0;
+    }
+    place(c, m->wx, m->wy, m->ww - (2 * c->bw), m->wh - (2 * c->bw));
+  }
+}
+
+/* layouts place clients instead of resizing them; the geometry is
+ * taken at once (later placements depend on it), the window is
+ * configured by applyplan() once the layout is done */
+void
+place(Client *c, int x, int y, int w, int h) {
+	if(applysizehints(c, &x, &y, &w, &h, False)) {
+		if(x != c->x)
+			c->pending |= CWX;
+		if(y != c->y)
+			c->pending |= CWY;
+		if(w != c->w)
+			c->pending |= CWWidth;
+		if(h != c->h)
+			c->pending |= CWHeight;
+		c->oldx = c->x; c->x = x;
+		c->oldy = c->y; c->y = y;
+		c->oldw = c->w; c->w = w;
+		c->oldh = c->h; c->h = h;
+	}
+	if(c->bw != c->cbw)
+		c->pending |= CWBorderWidth;
+}
+
+void
+resize(Client *c, int x, int y, int w, int h, Bool interact) {
+	if(applysizehints(c, &x, &y, &w, &h, interact))
+		resizeclient(c, x, y, w, h);
+}
+
+void
+resizeclient(Client *c, int x, int y, int w, int h) {
+	XWindowChanges wc;
+
+	c->oldx = c->x; c->x = wc.x = x;
+	c->oldy = c->y; c->y = wc.y = y;
+	c->oldw = c->w; c->w = wc.width = w;
+	c->oldh = c->h; c->h = wc.height = h;
+	wc.border_width = c->cbw = c->bw;
+	XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
+	c->pending = 0;
+	c->hidden = False;
+	configure(c);
+}
+
+void
+showhide(Client *c) {
+	if(!c)
+		return;
+	if(ISVISIBLE(c)) { /* show clients top down */
+		if(c->hidden) { /* moved back by applyplan(), with the layout's geometry */
+			c->hidden = False;
+			c->pending |= CWX|CWY;
+		}
+		if((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) && !c->isfullscreen)
+			resize(c, c->x, c->y, c->w, c->h, False);
+		showhide(c->snext);
+	}
+	else { /* hide clients bottom up */
+		showhide(c->snext);
+		if(!c->hidden) {
+			XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+			c->hidden = True;
+		}
+	}
+}
+
+void
+tile(Monitor *m) {
+	unsigned int i, n, h, mw, my, ty;
+	float mfacts = 0, sfacts = 0;
+	Client *c, **t = m->vis[ListTiled];
+
+    // Collect the cfacts:
+	for(n = 0; n < m->nvis[ListTiled]; n++) {
+        // TODO: siin vist korjatakse kõik vastava area (st master v stack)
+        // factid kokku, et saaks kliente omavahel võrrelda;
+		if(n < m->nmasters[m->curtag])
+			mfacts += t[n]->cfact;
+		else
+			sfacts += t[n]->cfact;
+	}
+	if(n == 0)
+		return;
+
+	if(n > m->nmasters[m->curtag]) // if more clients than master slots
+		mw = m->nmasters[m->curtag] ? m->ww * m->mfacts[m->curtag] : 0;
+	else
+		mw = m->ww;
+	for(i = my = ty = 0; i < n; i++) {
+		c = t[i];
+		if(n == 1) {
+			if (c->bw) {
+				/* remove border when only one window is on the current tag */
+				c->oldbw = c->bw;
+				c->bw = 0;
+			}
+		} else if(!c->bw && c->oldbw) {
+			/* restore border when more than one window is displayed */
+			c->bw = c->oldbw;
+			c->oldbw = 0;
+		}
+        // TODO: cfacts tekitab siin pertagi patchiga segadust
+		/*if(i < m->nmaster) {*/ // oli enne
+			/*h = (m->wh - my) * (c->cfact / mfacts);*/ // oli enne
+/*-	          h = (m->wh - my) / (MIN(n, m->nmaster) - i);*/ // seda tahtis pertag patch eemaldada
+		if(i < m->nmasters[m->curtag]) { // ie we're processing master area client
+			/*h = (m->wh - my) / (MIN(n, m->nmasters[m->curtag]) - i);*/ // see oli koos pertagi ja ctagiga; ilmselgelt välistab see cfacti funktsionaalsuse;
+            h = (m->wh - my) * (c->cfact / mfacts); // oli enne
+			place(c,
+                   m->wx,
+                   m->wy + my,
+                   mw - (2*c->bw),
+                   h - (2*c->bw));
+			my += HEIGHT(c);
+			mfacts -= c->cfact;
+		} else { // slave stack;
+			h = (m->wh - ty) * (c->cfact / sfacts);
+			place(c,
+                   m->wx + mw,
+                   m->wy + ty,
+                   m->ww - mw - (2*c->bw),
+                   h - (2*c->bw));
+			ty += HEIGHT(c);
+			sfacts -= c->cfact;
+		}
+	}
+}
+
+/* rebuilds the vis lists of m if anything invalidated them:
+ *   ListTiled       visible, not floating (what nexttiled() walks)
+ *   ListFocus       visible, not in the skip list
+ *   ListFocusTiled  ListFocus, not floating
+ *   ListFocusFloat  ListFocus, floating */
+void
+updatevis(Monitor *m) {
+	unsigned int in;
+	int n, l;
+	Client *c;
+
+	if(!m->visdirty)
+		return;
+	for(n = 0, c = m->clients; c; c = c->next, n++);
+	if(n > m->vissize) {
+		free(m->vis[0]);
+		m->vissize = MAX(n, 2 * m->vissize);
+		if(!(m->vis[0] = malloc(ListLast * m->vissize * sizeof(Client *))))
+			die("fatal: could not malloc() %u bytes\n", ListLast * m->vissize * sizeof(Client *));
+		for(l = 1; l < ListLast; l++)
+			m->vis[l] = m->vis[0] + l * m->vissize;
+	}
+	for(l = 0; l < ListLast; l++)
+		m->nvis[l] = 0;
+	for(c = m->clients; c; c = c->next) {
+		in = 0;
+		if(ISVISIBLE(c)) {
+			if(!c->isfloating)
+				in |= 1 << ListTiled;
+			if(!(c->classflags & ClassSkip))
+				in |= 1 << ListFocus | 1 << (c->isfloating ? ListFocusFloat : ListFocusTiled);
+		}
+		c->visin = in;
+		for(l = 0; l < ListLast; l++) {
+			c->vispos[l] = m->nvis[l];
+			if(in & 1 << l)
+				m->vis[l][m->nvis[l]++] = c;
+		}
+	}
+	m->visdirty = False;
+}
@@ -49,6 +49,7 @@ tilemovemouse(const Arg *arg) {
         case Expose:
         case MapRequest:
             handler[ev.type](&ev);
+            flushbars();
             break;
         case MotionNotify:
             x = ev.xmotion.x;